@@ -81,6 +81,18 @@ exec (const char *file)
   return (pid_t) syscall1 (SYS_EXEC, file);
 }
 
+pid_t
+fork (void)
+{
+  return (pid_t) syscall0 (SYS_FORK);
+}
+
+pid_t
+exec_rss (const char *file, int max_pages)
+{
+  return (pid_t) syscall2 (SYS_EXEC_RSS, file, max_pages);
+}
+
 int
 wait (pid_t pid)
 {
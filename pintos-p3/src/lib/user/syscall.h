@@ -23,6 +23,8 @@ typedef int mapid_t;
 void halt (void) NO_RETURN;
 void exit (int status) NO_RETURN;
 pid_t exec (const char *file);
+pid_t fork (void);
+pid_t exec_rss (const char *file, int max_pages);
 int wait (pid_t);
 bool create (const char *file, unsigned initial_size);
 bool remove (const char *file);
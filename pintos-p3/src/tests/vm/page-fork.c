@@ -0,0 +1,47 @@
+/* Forks a process with a buffer full of data, has the child
+   overwrite it, and verifies that the parent's copy is not
+   affected by the child's writes. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (64 * 1024)
+
+static char buf[SIZE];
+
+/* Returns true if every byte of buf is VALUE. */
+static bool
+buf_is (char value)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != value)
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  pid_t child;
+
+  msg ("fill buffer");
+  memset (buf, 0x5a, sizeof buf);
+
+  child = fork ();
+  if (child == 0)
+    {
+      /* Child: nothing is printed here, to keep output in order. */
+      if (!buf_is (0x5a))
+        exit (1);
+      memset (buf, 0xa5, sizeof buf);
+      exit (buf_is ((char) 0xa5) ? 81 : 2);
+    }
+  msg ("wait(fork()) = %d", wait (child));
+  if (!buf_is (0x5a))
+    fail ("child's writes are visible in the parent");
+  msg ("parent's buffer is intact");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(page-fork) begin
+(page-fork) fill buffer
+page-fork: exit(81)
+(page-fork) wait(fork()) = 81
+(page-fork) parent's buffer is intact
+(page-fork) end
+page-fork: exit(0)
+EOF
+pass;
@@ -0,0 +1,20 @@
+/* Runs child-linear, which works through 1 MB of memory, limited
+   to far fewer resident pages than that, and checks that it still
+   gets the right answer.  Also checks that a negative limit is
+   rejected. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  pid_t child;
+
+  CHECK (exec_rss ("child-linear", -1) == -1,
+         "exec_rss \"child-linear\" with negative limit");
+  CHECK ((child = exec_rss ("child-linear", 32)) != -1,
+         "exec_rss \"child-linear\" limited to 32 pages");
+  CHECK (wait (child) == 0x42, "wait for child");
+}
@@ -0,0 +1,31 @@
+/* Reads all of a 4 MB array that has never been written, more than
+   fits in memory, then writes one byte on every 64th page and
+   checks that those pages, and only those, changed. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (4 * 1024 * 1024)
+#define STRIDE (64 * 4096)
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  size_t i;
+
+  msg ("read untouched memory");
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != 0)
+      fail ("byte %zu != 0", i);
+
+  msg ("write sparse pages");
+  for (i = 0; i < SIZE; i += STRIDE)
+    buf[i] = 0x5a;
+
+  msg ("check");
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != (i % STRIDE == 0 ? 0x5a : 0))
+      fail ("byte %zu is %d", i, buf[i]);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(page-sparse) begin
+(page-sparse) read untouched memory
+(page-sparse) write sparse pages
+(page-sparse) check
+(page-sparse) end
+page-sparse: exit(0)
+EOF
+pass;
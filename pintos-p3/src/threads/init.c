@@ -38,6 +38,7 @@
 #endif
 #include "vm/frame.h"
 #include "vm/swap.h"
+#include "vm/share.h"
 #include "userprog/process.h"
 
 /* Page directory with kernel mappings only. */
@@ -59,6 +60,12 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+#ifdef USERPROG
+/* -rss: Resident-set limit, in pages, for the processes run as
+   actions, or 0 for none. */
+static size_t rss_limit;
+#endif
+
 static void bss_init (void);
 static void paging_init (void);
 
@@ -122,6 +129,8 @@ main (void)
   timer_calibrate ();
 
   frame_init();
+  page_init();
+  share_init();
 
 #ifdef FILESYS
   /* Initialize file system. */
@@ -132,6 +141,7 @@ main (void)
 
   lock_init(&file_lock);
   swap_init();
+  frame_start_pageout();
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -264,6 +274,8 @@ parse_options (char **argv)
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+      else if (!strcmp (name, "-rss"))
+        rss_limit = atoi (value);
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -290,7 +302,7 @@ run_task (char **argv)
   
   printf ("Executing '%s':\n", task);
 #ifdef USERPROG
-  process_wait (process_execute (task));
+  process_wait (process_execute (task, rss_limit));
 #else
   run_test (task);
 #endif
@@ -386,6 +398,7 @@ usage (void)
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -rss=COUNT         Limit each process to COUNT resident pages.\n"
 #endif
           );
   shutdown_power_off ();
@@ -202,6 +202,8 @@ thread_create (const char *name, int priority,
   // add this thread to kernel thread's children list
   struct thread *kernel_t = thread_current();
   t->parent = kernel_t->tid;
+  // children inherit the resident-set limit, unless exec'd with another
+  t->rss_limit = kernel_t->rss_limit;
   t->cmdline_page = aux;
   struct child_wrapper *childwp = malloc(sizeof(struct child_wrapper));
   childwp->realchild = t;
@@ -494,6 +496,10 @@ init_thread (struct thread *t, const char *name, int priority)
   t->wrapper = NULL;
   t->exitstatus = -1;
   t->supp_pt_initialized = false;
+  t->fault_next = NULL;
+  t->fault_window = 0;
+  t->rss = 0;
+  t->rss_limit = 0;
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
   intr_set_level (old_level);
@@ -116,6 +116,10 @@ struct thread
     // for vm
     struct hash supp_pt;   // supplemental page table
     bool supp_pt_initialized; // has it been initialized? can't at thread_init time.
+    void *fault_next; // page a sequential fault would hit next
+    size_t fault_window; // pages mapped after the last fault
+    size_t rss; // frames charged to this process, see vm/frame.c
+    size_t rss_limit; // most frames it should hold, 0 if unlimited
 
 
 #ifdef USERPROG
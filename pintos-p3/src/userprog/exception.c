@@ -169,12 +169,16 @@ page_fault (struct intr_frame *f)
 
   if (not_present && user) {
     DEBUG_PRINT(("pagefault- about to try and page in %p.\n", fault_addr));
-    if (!page_in (fault_addr, f->esp)) {
+    if (!page_in (fault_addr, write, f->esp)) {
         DEBUG_PRINT(("Tried to page in %p and failed. process dying.\n", fault_addr));
         kill(f);
       } else return;
   }
 
+  /* A write to a page still shared copy-on-write after fork(). */
+  if (!not_present && write && user && page_cow (fault_addr))
+    return;
+
   printf ("Page fault at %p: %s error %s page in %s context.\n",
           fault_addr,
           not_present ? "not present" : "rights violation",
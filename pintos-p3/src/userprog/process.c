@@ -33,21 +33,32 @@
 #endif
 
 static thread_func start_process NO_RETURN;
+static thread_func start_fork NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
 
 
 char* space = " ";
 
+/* Passed from process_execute() to start_process(), in a page of
+   its own. */
+struct exec_args
+  {
+    size_t rss_limit;           /* Resident-set limit, 0 if none. */
+    char cmd_line[PGSIZE - sizeof (size_t)]; /* Command line. */
+  };
+
 /* Starts a new thread running a user program loaded from
-   FILENAME.  The new thread may be scheduled (and may even exit)
-   before process_execute() returns.  Returns the new process's
-   thread id, or TID_ERROR if the thread cannot be created.
+   FILENAME, limited to RSS_LIMIT resident pages (or unlimited if
+   RSS_LIMIT is 0).  The new thread may be scheduled (and may even
+   exit) before process_execute() returns.  Returns the new
+   process's thread id, or TID_ERROR if the thread cannot be
+   created.
 */
 tid_t
-process_execute (const char *file_name) 
+process_execute (const char *file_name, size_t rss_limit) 
 {
   char fn_copy[60];
-  char* page_of_filename;
+  struct exec_args* page_of_filename;
   tid_t tid;
 
   /* Make a copy of FILE_NAME.
@@ -55,7 +66,9 @@ process_execute (const char *file_name)
   page_of_filename = palloc_get_page (0);
   if (page_of_filename == NULL)
     return TID_ERROR;
-  strlcpy (page_of_filename, file_name, PGSIZE);
+  page_of_filename->rss_limit = rss_limit;
+  strlcpy (page_of_filename->cmd_line, file_name,
+           sizeof page_of_filename->cmd_line);
   strlcpy (fn_copy, file_name, 60);
 
   /* Create a new thread to execute FILE_NAME. */
@@ -72,7 +85,8 @@ process_execute (const char *file_name)
 static void
 start_process (void *file_name_)
 {
-  char *file_name = file_name_;
+  struct exec_args *args = file_name_;
+  char *file_name = args->cmd_line;
   //printf("in start_process, file_name is %s\n", file_name);
   struct intr_frame if_;
   bool success;
@@ -82,6 +96,7 @@ start_process (void *file_name_)
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
+  thread_current ()->rss_limit = args->rss_limit;
   success = load (file_name, &if_.eip, &if_.esp);
   //printf("loaded filename! going to free page %p.\n", (void*) file_name_);
   palloc_free_page (file_name_);
@@ -114,6 +129,95 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+/* Passed from process_fork() to start_fork(). */
+struct fork_args
+  {
+    struct thread *parent;      /* The forking process. */
+    struct intr_frame *if_;     /* Its user register state. */
+    struct semaphore done;      /* Upped once the child is set up. */
+    bool success;               /* Was the child set up? */
+  };
+
+/* Creates a child of the current process that is a copy of it,
+   resuming from the system call whose user register state is IF_.
+   The child shares the parent's resident pages copy-on-write, so
+   nothing is copied until one of them writes.  Returns the child's
+   thread id, or TID_ERROR if the child cannot be created. */
+tid_t
+process_fork (struct intr_frame *if_)
+{
+  struct thread *cur = thread_current ();
+  struct fork_args args;
+  tid_t tid;
+
+  args.parent = cur;
+  args.if_ = if_;
+  sema_init (&args.done, 0);
+  tid = thread_create (cur->name, PRI_DEFAULT, start_fork, &args);
+  if (tid == TID_ERROR)
+    return TID_ERROR;
+
+  /* The child works from our page table and stack, so we can't
+     run until it is done with them. */
+  sema_down (&args.done);
+  return args.success ? tid : TID_ERROR;
+}
+
+/* Sets up the address space and open files of a process forked
+   from PARENT.  Returns true if successful. */
+static bool
+fork_process (struct thread *parent)
+{
+  struct thread *t = thread_current ();
+
+  t->pagedir = pagedir_create ();
+  hash_init (&t->supp_pt, page_hash, page_less, NULL);
+  t->supp_pt_initialized = true;
+  if (t->pagedir == NULL)
+    return false;
+  process_activate ();
+
+  lock_acquire (&file_lock);
+  if (parent->exe_file != NULL)
+    {
+      t->exe_file = file_reopen (parent->exe_file);
+      if (t->exe_file != NULL)
+        file_deny_write (t->exe_file);
+    }
+  lock_release (&file_lock);
+  if (t->exe_file == NULL)
+    return false;
+
+  return page_fork (parent, t->exe_file) && syscall_fork_files (parent);
+}
+
+/* A thread function that turns a new thread into a copy of the
+   process that forked it and starts it running. */
+static void
+start_fork (void *args_)
+{
+  struct fork_args *args = args_;
+  struct thread *cur = thread_current ();
+  struct intr_frame if_;
+  bool success;
+
+  memcpy (&if_, args->if_, sizeof if_);
+  success = fork_process (args->parent);
+  cur->wrapper->loaded = success ? 1 : -1;
+
+  /* ARGS lives on the parent's stack, so it is gone once the
+     parent wakes up. */
+  args->success = success;
+  sema_up (&args->done);
+  if (!success)
+    thread_exit ();
+
+  /* fork() returns 0 in the child. */
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
@@ -1,8 +1,10 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 #include "threads/thread.h"
+#include "threads/interrupt.h"
 
-tid_t process_execute (const char *file_name);
+tid_t process_execute (const char *file_name, size_t rss_limit);
+tid_t process_fork (struct intr_frame *);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
@@ -9,6 +9,7 @@
 #include "devices/shutdown.h"
 #include "userprog/process.h"
 #include "threads/synch.h"
+#include "threads/malloc.h"
 #include <stdlib.h>
 
 #ifndef DEBUG_BULLSHIT
@@ -28,6 +29,8 @@ static int sys_exit (uint8_t*, void*);
 static void sys_halt (uint8_t*, void*);
 static int sys_wait (uint8_t*, void*);
 static pid_t sys_exec (uint8_t*, void*);
+static pid_t sys_exec_rss (uint8_t*, void*);
+static pid_t do_exec (const char *, size_t rss_limit);
 static bool sys_create (uint8_t*, void*);
 static bool sys_remove (uint8_t*, void*);
 static int sys_open (uint8_t*, void*);
@@ -36,6 +39,7 @@ static int sys_read (uint8_t*, void*);
 static void sys_seek (uint8_t*, void*);
 static unsigned sys_tell (uint8_t*, void*);
 static void sys_close (uint8_t*, void*);
+static pid_t sys_fork (struct intr_frame *);
 
 void check_buffer(const void *buffer, unsigned size);
 void check_ptr(const void *ptr);
@@ -66,6 +70,40 @@ get_file(int fd) {
   return target_file;
 }
 
+/* Gives the current process, newly forked from PARENT, its own
+   handle on each of PARENT's open files, with the same descriptor
+   number and position.  Returns true if successful. */
+bool
+syscall_fork_files (struct thread *parent) {
+  struct thread *cur = thread_current();
+  struct list_elem *e;
+  bool success = true;
+
+  lock_acquire(&file_lock);
+  for (e = list_begin (&parent->file_list); e != list_end (&parent->file_list);
+       e = list_next (e))
+  {
+    struct file_in_thread *pf = list_entry (e, struct file_in_thread, file_elem);
+    struct file_in_thread *cf = malloc(sizeof(struct file_in_thread));
+    if (cf == NULL) {
+      success = false;
+      break;
+    }
+    cf->fileptr = file_reopen(pf->fileptr);
+    if (cf->fileptr == NULL) {
+      free(cf);
+      success = false;
+      break;
+    }
+    file_seek(cf->fileptr, file_tell(pf->fileptr));
+    cf->fd = pf->fd;
+    list_push_back(&cur->file_list, &cf->file_elem);
+  }
+  cur->fd = parent->fd;
+  lock_release(&file_lock);
+  return success;
+}
+
 void
 check_str (const void* str) {
   void *ptr = pagedir_get_page(thread_current()->pagedir, str);
@@ -121,6 +159,8 @@ syscall_handler (struct intr_frame *f)
     break;
   case SYS_EXEC: syscall = sys_exec;
     break;
+  case SYS_EXEC_RSS: syscall = sys_exec_rss;
+    break;
   case SYS_CREATE: syscall = sys_create;
     break;
   case SYS_REMOVE: syscall = sys_remove;
@@ -137,6 +177,10 @@ syscall_handler (struct intr_frame *f)
     break;
   case SYS_CLOSE: syscall = sys_close;
     break;
+  case SYS_FORK:
+    /* Needs the whole register state, not just the arguments. */
+    f->eax = sys_fork (f);
+    return;
   default:
     syscall = NULL;
     break;
@@ -160,13 +204,35 @@ static pid_t sys_exec (uint8_t* args_start, void* esp UNUSED) {
   DEBUG_PRINT(("in sys_exec***\n"));
   char* filename;
   copy_in (&filename, args_start, sizeof(char*));
+
+  /* The child inherits our resident-set limit. */
+  return do_exec (filename, thread_current()->rss_limit);
+}
+
+/* Like exec, but limits the child to the number of resident pages
+   given as the second argument, or none if it is 0. */
+static pid_t sys_exec_rss (uint8_t* args_start, void* esp UNUSED) {
+  char* filename;
+  int rss_limit;
+
+  copy_in (&filename, args_start, sizeof(char*));
+  copy_in (&rss_limit, args_start + sizeof(char*), sizeof rss_limit);
+  if (rss_limit < 0)
+    return -1;
+  return do_exec (filename, rss_limit);
+}
+
+/* Runs the command line at user address FILENAME in a new process
+   limited to RSS_LIMIT resident pages, and waits for it to load.
+   Returns its process id, or -1 if it could not be started. */
+static pid_t do_exec (const char* filename, size_t rss_limit) {
   char* kernel_page = copy_in_string (filename);
   //check_str(cmd_line);
   //printf("****the kernel page is %p in kernel space\n", (void*)kernel_page);
   //DEBUG_PRINT(("copied in cmdline*** %s\n", kernel_page));
   
   //DEBUG_PRINT(("args_start is %s\n", args_start));
-  pid_t process_id = process_execute((const char*)kernel_page);
+  pid_t process_id = process_execute((const char*)kernel_page, rss_limit);
   //DEBUG_PRINT(("called process_execute***\n"));
   palloc_free_page (kernel_page);
   if (process_id == TID_ERROR)
@@ -193,6 +259,14 @@ static pid_t sys_exec (uint8_t* args_start, void* esp UNUSED) {
 
 }
 
+static pid_t sys_fork (struct intr_frame *f) {
+  DEBUG_PRINT(("in sys_fork***\n"));
+  tid_t tid = process_fork (f);
+  if (tid == TID_ERROR)
+    return -1;
+  return tid;
+}
+
 static int sys_wait (uint8_t* args_start , void* esp UNUSED) {
   DEBUG_PRINT(("in sys_wait****\n"));
 
@@ -1,9 +1,10 @@
 #include "frame.h"
+#include "vm/swap.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/loader.h"
+#include "devices/timer.h"
 #include <debug.h>
-#include <random.h>
 #ifndef DEBUG_BULLSHIT
 #define DEBUG_BULLSHIT
 #ifdef DEBUG
@@ -32,7 +33,43 @@ kernel.
 
 */
 
+/* Frames holding no page, so that allocation need not scan for
+   one.  A frame is on this list exactly when its page is null.
 
+   Every other frame is charged to the process owning its page, in
+   that process's rss, so that a process with an rss_limit can be
+   made to evict its own pages once it reaches the limit instead of
+   taking frames from everyone else.  The limit is soft: a process
+   whose frames are all pinned goes over it rather than wait. */
+static struct list free_frames;
+static size_t free_cnt;         /* Number of frames in free_frames. */
+static struct lock free_lock;   /* Protects free_frames, free_cnt,
+                                   and every thread's rss. */
+static struct condition frame_freed;    /* A frame became free. */
+static struct condition pageout_wanted; /* free_cnt fell below low. */
+
+/* The page-out daemon evicts in the background whenever fewer than
+   free_low frames are free, until free_high are, so that a page
+   fault normally finds a free frame waiting and never writes to
+   swap itself. */
+static size_t free_low;
+static size_t free_high;
+
+/* Working sets.  Every WS_INTERVAL ticks, at most, the accessed
+   bits of all resident pages are sampled and cleared; a page seen
+   accessed in one of the last WS_WINDOW samples is in its owner's
+   working set, and the clock leaves it alone while there are
+   other pages to take.  Sampling is done on the way into the
+   clock, since that is the only time the working sets are used.
+   Protected by scan_lock. */
+#define WS_INTERVAL (TIMER_FREQ / 4)
+#define WS_WINDOW 4
+static unsigned ws_epoch;       /* Number of samples taken. */
+static int64_t ws_sampled;      /* When the last one was taken. */
+
+static struct frame *take_free (struct page *page, bool over_limit);
+static bool frame_evict (struct thread *owner);
+static void pageout_daemon (void *aux);
 
 void
 frame_init (void)
@@ -40,6 +77,10 @@ frame_init (void)
   void *base;
 
   lock_init (&scan_lock);
+  list_init (&free_frames);
+  lock_init (&free_lock);
+  cond_init (&frame_freed);
+  cond_init (&pageout_wanted);
 
   frames = malloc (sizeof *frames * init_ram_pages);
   if (frames == NULL)
@@ -51,80 +92,251 @@ frame_init (void)
       lock_init (&f->lock);
       f->base = base;
       f->page = NULL;
+      f->inode = NULL;
+      list_init (&f->sharers);
+      f->share_cnt = 0;
+      list_push_back (&free_frames, &f->free_elem);
     }
-  random_init(3);
+  free_cnt = frame_cnt;
+  free_low = frame_cnt / 16 > 0 ? frame_cnt / 16 : 1;
+  free_high = free_low * 2;
 }
 
-/* Tries to allocate and lock a frame for PAGE.
-   Returns the frame if successful, false on failure. */
+/* Starts the page-out daemon.  Must be called once swap is
+   available. */
+void
+frame_start_pageout (void)
+{
+  if (thread_create ("pageout", PRI_DEFAULT, pageout_daemon, NULL)
+      == TID_ERROR)
+    PANIC ("couldn't start page-out daemon");
+}
+
+/* Page-out daemon.  Sleeps until free frames run low, then evicts
+   pages, writing dirty ones out in clusters, until enough are free
+   again.  If nothing can be evicted right now, because every frame
+   is pinned or recently used, lets other threads run and tries
+   again. */
+static void
+pageout_daemon (void *aux UNUSED)
+{
+  for (;;) {
+    lock_acquire(&free_lock);
+    while (free_cnt >= free_low)
+      cond_wait(&pageout_wanted, &free_lock);
+    lock_release(&free_lock);
+
+    for (;;) {
+      bool enough;
+
+      lock_acquire(&free_lock);
+      enough = free_cnt >= free_high;
+      lock_release(&free_lock);
+      if (enough)
+        break;
+      if (!frame_evict(NULL)) {
+        thread_yield();
+        break;
+      }
+    }
+  }
+}
+
+/* Returns true if thread T holds as many frames as it may. */
+static bool
+rss_full (struct thread *t)
+{
+  return t->rss_limit != 0 && t->rss >= t->rss_limit;
+}
+
+/* Takes a frame off the free list, locks it, and gives it to
+   PAGE.  Returns the frame, or a null pointer if the list is
+   empty or PAGE's owner is at its resident-set limit; nothing is
+   evicted. */
 struct frame *
-try_frame_alloc_and_lock (struct page *page)
+frame_take_free (struct page *page)
 {
-  return NULL;
+  return take_free(page, false);
+}
+
+/* Does the work of frame_take_free(), ignoring the resident-set
+   limit if OVER_LIMIT is true. */
+static struct frame *
+take_free (struct page *page, bool over_limit)
+{
+  struct frame *f = NULL;
+
+  lock_acquire(&free_lock);
+  if (!list_empty(&free_frames) && (over_limit || !rss_full(page->owner))) {
+    f = list_entry(list_pop_front(&free_frames), struct frame, free_elem);
+    free_cnt--;
+    page->owner->rss++;
+  }
+  if (free_cnt < free_low)
+    cond_signal(&pageout_wanted, &free_lock);
+  lock_release(&free_lock);
+  if (!f)
+    return NULL;
 
+  /* The clock may be looking at F, but only briefly. */
+  lock_acquire(&f->lock);
+  ASSERT(!f->page);
+  DEBUG_PRINT(("LOCKING %p into frame at %p\n", page->uaddr, f->base));
+  f->page = page;
+  page->frame = f;
+  return f;
 }
 
-/* Tries really hard to allocate and lock a frame for PAGE.
-   PAGE may not have a frame.
+/* Tries to allocate and lock a frame for PAGE.
+   Takes a frame off the free list if there is one.  Eviction is
+   left to the page-out daemon, unless PAGE's owner is at its
+   resident-set limit: then it evicts one of its own pages first,
+   or goes over the limit if it has none it can give up.
    Returns the frame if successful, false on failure. */
 struct frame *
-frame_alloc_and_lock (struct page *page)
+try_frame_alloc_and_lock (struct page *page)
 {
-  DEBUG_PRINT(("frame_alloc_and_lock time... for page at %p\n", page->uaddr));
-  ASSERT(!page->frame);
-  //DEBUG_PRINT(("hmm\n"));
-  lock_acquire(&scan_lock);
   ASSERT(!page->frame);
-  //DEBUG_PRINT(("mmhmm\n"));
-  for (int i = 0; i < frame_cnt; i++) {
+  if (rss_full(page->owner) && !frame_evict(page->owner))
+    return take_free(page, true);
+  return take_free(page, false);
+}
+
+/* Moves the charge for a shared frame from the owner of page FROM
+   to the owner of page TO, which is taking over the frame. */
+void
+frame_recharge (struct page *from, struct page *to)
+{
+  lock_acquire(&free_lock);
+  from->owner->rss--;
+  to->owner->rss++;
+  lock_release(&free_lock);
+}
+
+/* Returns true if page P, whose frame is locked, has been accessed
+   since it was last looked at, noting that it is in its owner's
+   working set. */
+static bool
+ws_accessed (struct page *p)
+{
+  if (!page_accessed_recently(p))
+    return false;
+  p->ws_epoch = ws_epoch;
+  return true;
+}
+
+/* Returns true if page P is in its owner's working set. */
+static bool
+ws_active (struct page *p)
+{
+  return ws_epoch - p->ws_epoch < WS_WINDOW;
+}
+
+/* Takes a working-set sample, if one is due.  Frames that are
+   locked are skipped; their pages are in use anyhow.  scan_lock
+   must be held. */
+static void
+ws_sample (void)
+{
+  size_t i;
+
+  if (timer_elapsed(ws_sampled) < WS_INTERVAL)
+    return;
+  ws_sampled = timer_ticks();
+  ws_epoch++;
+  for (i = 0; i < frame_cnt; i++) {
     struct frame *f = &frames[i];
-    //printf("about to try and lock frame at %p\n", f->base);
-    if (lock_try_acquire(&f->lock)) {
-      //DEBUG_PRINT(("coolbeans i have a lock for %p\n", f->base));
-      if (!f->page) {
-        DEBUG_PRINT(("LOCKING %p into frame at %p\n", page->uaddr, f->base));
-
-        f->page = page;
-        page->frame = f;
-        //pagedir_set_page(thread_current()->pagedir, page->uaddr, f->base, p->writable);
-        lock_release(&scan_lock);
-        return f;
-      }
+
+    if (lock_held_by_current_thread(&f->lock)
+        || !lock_try_acquire(&f->lock))
+      continue;
+    if (f->page)
+      ws_accessed(f->page);
+    lock_release(&f->lock);
+  }
+}
+
+/* Evicts at least one page, putting its frame on the free list,
+   and returns true.  Only OWNER's pages are considered, unless
+   OWNER is null.  The victim is chosen with the clock: the hand
+   sweeps over the frames, skipping locked (pinned) ones and giving
+   each page that was accessed since the last sweep a second chance
+   by clearing its accessed bits.  The first two sweeps take only
+   clean pages outside their owners' working sets, which cost no
+   write to evict and are not wanted soon; the third takes any page
+   outside a working set, and the fourth any page not accessed in
+   the meantime.  A dirty victim has to be written anyway, so the
+   hand goes a little further to collect up to SWAP_CLUSTER of them
+   to write together.  Returns false if no page could be
+   evicted. */
+static bool
+frame_evict (struct thread *owner)
+{
+  struct page *victims[SWAP_CLUSTER];
+  size_t cnt = 0;
+  size_t i, stop = frame_cnt * 4;
+
+  lock_acquire(&scan_lock);
+  ws_sample();
+  for (i = 0; i < stop && cnt < SWAP_CLUSTER; i++) {
+    struct frame *f = &frames[hand];
+    size_t sweep = i / frame_cnt;
+    struct page *victim;
+
+    if (++hand >= frame_cnt)
+      hand = 0;
+    /* Skip frames pinned by others, and ones we already hold. */
+    if (lock_held_by_current_thread(&f->lock)
+        || !lock_try_acquire(&f->lock))
+      continue;
+    victim = f->page;
+    if (!victim || (owner && victim->owner != owner)
+        || ws_accessed(victim)
+        || (sweep < 3 && ws_active(victim))
+        || (sweep < 2 && !page_is_clean(victim))) {
       lock_release(&f->lock);
+      continue;
     }
-  }
+    ASSERT(victim->page_current_loc == INFRAME);
 
-  // ok haha we are going to try to evict something random until we manage it :)
-  while(1) {
-    DEBUG_PRINT(("need to evict... trying again\n"));
-
-    unsigned int to_evict = random_ulong() % frame_cnt;
-    struct frame *f = &frames[to_evict];
-
-    DEBUG_PRINT(("attempting to evict frame at base_addr %p\n", f->base));
-    if (lock_try_acquire(&f->lock)) {
-      struct page* page_to_evict = f->page;
-      ASSERT(page_to_evict);
-      ASSERT(page_to_evict->frame->page == page_to_evict);
-      //ASSERT(pagedir_get_page(thread_current()->pagedir, page_to_evict->uaddr) == page_to_evict->frame->base);
-      DEBUG_PRINT(("got the lock, the page uaddr is %p\n", f->page->uaddr));
-      ASSERT(page_to_evict->page_current_loc == INFRAME);
-      page_out(page_to_evict);
-      DEBUG_PRINT(("finished calling page_out on %p\n", page_to_evict->uaddr));
-      ASSERT(f);
-      ASSERT(page);
-      f->page = page;
-      page->frame = f;
-      frame_lock(page);
-      lock_release(&scan_lock);
-      DEBUG_PRINT(("evicted %p and installed %p at frame %p\n",page_to_evict->uaddr, f->page->uaddr, f->base));
-      return f;
+    if (page_is_clean(victim)) {
+      /* Only worth taking if it is the first. */
+      if (cnt > 0) {
+        lock_release(&f->lock);
+        continue;
+      }
+      victims[cnt++] = victim;
+      break;
     }
+    DEBUG_PRINT(("evicting %p from frame at %p\n", victim->uaddr, f->base));
+    if (cnt == 0 && i + SWAP_CLUSTER * 4 < stop)
+      stop = i + SWAP_CLUSTER * 4;
+    victims[cnt++] = victim;
   }
-  PANIC ("no free frames");
   lock_release(&scan_lock);
-  return NULL;
+  if (cnt == 0)
+    return false;
+  page_out_cluster(victims, cnt);
+  return true;
+}
 
+/* Tries really hard to allocate and lock a frame for PAGE.
+   PAGE may not have a frame.  If no frame is free, waits for the
+   page-out daemon, or an exiting process, to free one.
+   Returns the frame. */
+struct frame *
+frame_alloc_and_lock (struct page *page)
+{
+  DEBUG_PRINT(("frame_alloc_and_lock time... for page at %p\n", page->uaddr));
+  for (;;) {
+    struct frame *f = try_frame_alloc_and_lock(page);
+    if (f)
+      return f;
+    lock_acquire(&free_lock);
+    while (list_empty(&free_frames))
+      cond_wait(&frame_freed, &free_lock);
+    lock_release(&free_lock);
+  }
 }
 
 /* Locks P's frame into memory, if it has one.
@@ -140,7 +352,7 @@ frame_lock (struct page *p) {
       lock_release(&f->lock);
       return;
     }
-    ASSERT(p == p->frame->page);
+    ASSERT(p == p->frame->page || f->share_cnt > 0);
     //ASSERT(pagedir_get_page(thread_current()->pagedir, p->uaddr) == p->frame->base);
   }
 }
@@ -154,10 +366,17 @@ frame_free (struct frame *f) {
   ASSERT(f);
   ASSERT((f->lock).holder == thread_current());
   ASSERT(f->page);
+  ASSERT(f->share_cnt == 0);
   //DEBUG_PRINT(("freeing frame %p from page %p\n", f->page->uaddr, f->base));
   struct page* p = f -> page;
   f->page = NULL;
   p -> frame = NULL;
+  lock_acquire(&free_lock);
+  list_push_back(&free_frames, &f->free_elem);
+  free_cnt++;
+  p->owner->rss--;
+  cond_signal(&frame_freed, &free_lock);
+  lock_release(&free_lock);
   lock_release(&f->lock);
 }
 
@@ -1,13 +1,27 @@
 #ifndef VM_FRAME_H
 #define VM_FRAME_H
 
+#include <hash.h>
+#include <list.h>
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "filesys/off_t.h"
 
 struct frame {
 	struct lock lock;
   struct page* page;
 	void *base;
+
+  /* Read-only file pages mapped by more than one process.
+     See vm/share.c. */
+  struct inode *inode;          /* Backing inode, if shared. */
+  off_t file_offset;            /* Offset of the page in INODE. */
+  size_t file_bytes;            /* Bytes read from there. */
+  struct list sharers;          /* Pages mapping this frame. */
+  unsigned share_cnt;           /* Number of pages in SHARERS. */
+  struct hash_elem share_elem;  /* Element in the shared-page table. */
+
+  struct list_elem free_elem;   /* Element in the free-frame list. */
 };
 
 static struct frame* frames;
@@ -18,8 +32,11 @@ static size_t hand;
 
 
 void frame_init (void);
+void frame_start_pageout (void);
+struct frame *frame_take_free (struct page *page);
 struct frame *try_frame_alloc_and_lock (struct page *page);
 struct frame *frame_alloc_and_lock (struct page *page);
+void frame_recharge (struct page *from, struct page *to);
 void frame_lock (struct page *p);
 void frame_free (struct frame *f);
 void frame_unlock (struct frame *f);
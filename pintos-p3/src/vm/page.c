@@ -1,6 +1,11 @@
 #include "vm/page.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "vm/frame.h"
+#include "vm/share.h"
+#include "vm/swap.h"
+#include "userprog/pagedir.h"
+#include <string.h>
 #include "threads/vaddr.h"
 #include "debug.h"
 #ifndef DEBUG_BULLSHIT
@@ -13,6 +18,72 @@
 #endif
 #endif
 
+/* A page of zeros, mapped read-only for reads of zero pages that
+   have never been written, so that they take no frame.  The first
+   write faults and gets the page a frame of its own. */
+static void *zero_page;
+
+/* Least and most pages mapped after a faulting page. */
+#define FAULT_AROUND_MIN 1
+#define FAULT_AROUND_MAX 16
+
+/* Sets up the shared zero page. */
+void
+page_init (void)
+{
+  zero_page = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+}
+
+/* Returns true if page P, which must have a frame, may be mapped
+   writable.  A frame shared after fork() is mapped read-only so
+   that the first write faults and copies it. */
+static bool
+page_map_writable (struct page *p)
+{
+  return p->writable && p->frame->share_cnt == 0;
+}
+
+/* Maps P's frame, which must be locked, at P's address in its
+   owner's page directory, in place of the zero page if that is
+   mapped there. */
+static void
+page_map (struct page *p)
+{
+  uint32_t *pd = p->owner->pagedir;
+  void *kpage = pagedir_get_page(pd, p->uaddr);
+
+  if (kpage == p->frame->base)
+    return;
+  if (kpage != NULL) {
+    ASSERT(kpage == zero_page);
+    pagedir_clear_page(pd, p->uaddr);
+  }
+  pagedir_set_page(pd, p->uaddr, p->frame->base, page_map_writable(p));
+}
+
+/* Gives page P, whose frame must be locked, a frame of its own if
+   it still shares one with another process after fork(), and maps
+   it writable.  P's frame, new or old, is left locked. */
+static void
+page_break_cow (struct page *p)
+{
+  uint32_t *pd = thread_current()->pagedir;
+  struct frame *old = p->frame;
+
+  ASSERT(p->writable);
+  if (old->share_cnt == 0)
+    return;
+  if (share_detach(p)) {
+    struct frame *f = frame_alloc_and_lock(p);
+    memcpy(f->base, old->base, PGSIZE);
+    p->page_current_loc = INFRAME;
+    p->dirty = true;
+    frame_unlock(old);
+  }
+  pagedir_clear_page(pd, p->uaddr);
+  pagedir_set_page(pd, p->uaddr, p->frame->base, true);
+}
+
 /* Destroys a page, which must be in the current process's
    page table.  Used as a callback for hash_destroy(). */
 static void
@@ -22,16 +93,22 @@ destroy_page (struct hash_elem *p_ , void *aux UNUSED)
   //DEBUG_PRINT(("DESTROYING PAGE with address %p, vaddr %p\n", page, page->uaddr));
   frame_lock(page);
   if (page->frame) {
-    ASSERT(page == page->frame->page);
+    struct frame *f = page->frame;
     if (pagedir_get_page(thread_current()->pagedir, page->uaddr)) {
       pagedir_clear_page(thread_current()->pagedir, page->uaddr);
       
     }
     //DEBUG_PRINT(("destroying page frame %p with kernel address %p\n", page->frame, page->frame->base));
-    //DEBUG_PRINT(("about to lock up the frame\n"));
-    //DEBUG_PRINT(("about to free the frame\n"));
-    frame_free(page->frame);
+    /* Other processes may still be mapping a shared frame. */
+    if (share_detach(page))
+      frame_unlock(f);
+    else {
+      ASSERT(page == f->page);
+      frame_free(f);
+    }
   }
+  if (page->sector != SWAP_NONE)
+    swap_free(page);
   free(page);
 }
 
@@ -90,6 +167,81 @@ page_for_addr (const void *address, void* esp)
   }
 }
 
+/* Returns T's page at user page UPAGE, or a null pointer if it
+   has none.  Unlike page_for_addr(), never allocates one. */
+static struct page *
+page_find (struct thread *t, const void *upage)
+{
+  struct page key;
+  struct hash_elem *e;
+
+  key.uaddr = (void *) upage;
+  e = hash_find(&t->supp_pt, &key.hash_elem);
+  return e ? hash_entry(e, struct page, hash_elem) : NULL;
+}
+
+/* Returns the page N pages away from swapped-out page P in the
+   current process, P's owner, if it is swapped out to the slot N
+   slots away from P's, with a free frame locked for it.  Returns a
+   null pointer if there is no such page or no frame is free; no
+   page is evicted to make room for one read ahead. */
+static struct page *
+page_swap_neighbor (struct page *p, int n)
+{
+  struct thread *t = thread_current();
+  uint8_t *uaddr = (uint8_t *) p->uaddr + n * PGSIZE;
+  struct page *q;
+
+  if (p->owner != t || !is_user_vaddr(uaddr))
+    return NULL;
+  q = page_find(t, uaddr);
+  if (!q || q->frame || q->page_current_loc != INSWAP || q->sector != p->sector + n)
+    return NULL;
+  return frame_take_free(q) ? q : NULL;
+}
+
+/* Swaps in page P, whose frame is locked, together with the pages
+   around it that were swapped out beside it, up to SWAP_CLUSTER
+   pages in all, so that a process paging back in a region it
+   paged out together reads it in one sweep.  The extra pages are
+   mapped with clear accessed bits and unlocked, so the clock
+   takes them back first if they go unused. */
+static void
+page_swap_in_around (struct page *p)
+{
+  struct page *cluster[SWAP_CLUSTER];
+  struct page *q;
+  size_t cnt = 0, i;
+  int n;
+
+  for (n = -1; cnt < SWAP_CLUSTER / 2
+               && (q = page_swap_neighbor(p, n)) != NULL; n--)
+    cluster[cnt++] = q;
+  /* Put the ones before P in slot order. */
+  for (i = 0; i < cnt / 2; i++) {
+    q = cluster[i];
+    cluster[i] = cluster[cnt - 1 - i];
+    cluster[cnt - 1 - i] = q;
+  }
+  cluster[cnt++] = p;
+  for (n = 1; cnt < SWAP_CLUSTER
+              && (q = page_swap_neighbor(p, n)) != NULL; n++)
+    cluster[cnt++] = q;
+
+  swap_in_cluster(cluster, cnt);
+  for (i = 0; i < cnt; i++) {
+    q = cluster[i];
+    if (q == p)
+      continue;
+    q -> page_current_loc = INFRAME;
+    pagedir_set_page(q->owner->pagedir, q->uaddr, q->frame->base,
+                     page_map_writable(q));
+    frame_unlock(q->frame);
+  }
+}
+
+static bool page_read_in (struct page *p);
+
 /* Locks a frame for page P and pages it in.
    Returns true if successful, false on failure. */
 static bool
@@ -97,9 +249,22 @@ do_page_in (struct page *p )
 {
   DEBUG_PRINT(("CALLING DOPAGE_IN on page at uaddr %p\n", p->uaddr));
   ASSERT(!p->frame);
+  if (share_page_in(p)) {
+    DEBUG_PRINT(("sharing frame at %p for %p\n", p->frame->base, p->uaddr));
+    p -> page_current_loc = INFRAME;
+    return true;
+  }
   struct frame* f = frame_alloc_and_lock(p);
   if (!f) return false;
   //p->frame = f;
+  return page_read_in(p);
+}
+
+/* Reads page P into its locked frame from wherever it is now.
+   Returns true if successful, false on failure. */
+static bool
+page_read_in (struct page *p)
+{
   switch (p->page_current_loc) {
   case FROMFILE:
     memset (p->frame->base, 0, PGSIZE);
@@ -112,6 +277,7 @@ do_page_in (struct page *p )
       DEBUG_PRINT(("those were not the same... actual_read_bytes was %d\n", actual_read_bytes));
       return false;
     }
+    share_register(p);
     break;
   case TOBEZEROED:
     DEBUG_PRINT(("initializing a zero page for p\n"));
@@ -122,7 +288,7 @@ do_page_in (struct page *p )
     break;
   case INSWAP:
     DEBUG_PRINT(("swapping in p\n"));
-    swap_in(p);
+    page_swap_in_around(p);
     break;
   default:
     PANIC("whats this page current loc um");
@@ -133,10 +299,62 @@ do_page_in (struct page *p )
   return true;
 }
 
-/* Faults in the page containing FAULT_ADDR.
+/* Maps the pages following P, which was just faulted in from LOC,
+   a file or zeros, that would be filled the same way: the rest of
+   the same stretch of file, or more zero pages.  After a read
+   fault, zero pages get the zero page rather than frames of their
+   own.  The window starts at FAULT_AROUND_MIN pages and doubles,
+   up to FAULT_AROUND_MAX, each time a fault lands just past the
+   last window, so that scanning a segment soon takes one fault per
+   several pages while scattered faults map little they won't use.
+   Only free frames are used, and the extra pages are left for the
+   clock as in page_swap_in_around(). */
+static void
+page_fault_around (struct page *p, enum page_current_loc loc, bool write)
+{
+  struct thread *t = thread_current();
+  uint8_t *upage = p->uaddr;
+  size_t n;
+
+  if (upage == t->fault_next)
+    t->fault_window = t->fault_window * 2 < FAULT_AROUND_MAX
+                      ? t->fault_window * 2 : FAULT_AROUND_MAX;
+  else
+    t->fault_window = FAULT_AROUND_MIN;
+
+  for (n = 1; n <= t->fault_window; n++) {
+    struct page *q = page_find(t, upage + n * PGSIZE);
+
+    if (!q || q->frame || q->page_current_loc != loc)
+      break;
+    if (loc == FROMFILE && (q->file != p->file
+                            || q->file_offset
+                               != p->file_offset + (off_t) (n * PGSIZE)))
+      break;
+    if (loc == TOBEZEROED && !write) {
+      if (!pagedir_get_page(t->pagedir, q->uaddr))
+        pagedir_set_page(t->pagedir, q->uaddr, zero_page, false);
+      continue;
+    }
+    if (share_page_in(q))
+      q -> page_current_loc = INFRAME;
+    else if (!frame_take_free(q))
+      break;
+    else if (!page_read_in(q)) {
+      frame_free(q->frame);
+      break;
+    }
+    page_map(q);
+    frame_unlock(q->frame);
+  }
+  t->fault_next = upage + n * PGSIZE;
+}
+
+/* Faults in the page containing FAULT_ADDR, and maybe some of the
+   pages after it (see page_fault_around()).
    Returns true if successful, false on failure. */
 bool
-page_in (void *fault_addr, void* esp)
+page_in (void *fault_addr, bool write, void* esp)
 {
   //DEBUG_PRINT(("CALLING PAGE_IN on %p\n", fault_addr));
   //if (esp > fault_addr && esp != fault_addr + 4 && esp != fault_addr + 32) {
@@ -151,7 +369,16 @@ page_in (void *fault_addr, void* esp)
   //DEBUG_PRINT(("got a page! %p\n", p->uaddr));
   frame_lock(p);
 
+  enum page_current_loc loc = p->page_current_loc;
+  bool around = false;
+  if (!p->frame && loc == TOBEZEROED && !write) {
+    /* Nothing to read yet. */
+    pagedir_set_page(thread_current()->pagedir, p->uaddr, zero_page, false);
+    page_fault_around(p, loc, write);
+    return true;
+  }
   if (!p->frame){
+    around = loc == FROMFILE || loc == TOBEZEROED;
     if (!do_page_in(p)) {
       // DEBUG_PRINT(("failed to do_page_in\n"));
       if (p->frame) frame_unlock(p->frame);
@@ -161,58 +388,250 @@ page_in (void *fault_addr, void* esp)
   ASSERT(p->frame);
   ASSERT(p->frame->lock.holder == thread_current());
   ASSERT(p->page_current_loc == INFRAME);
-  if (pagedir_get_page(thread_current()->pagedir, p->uaddr) == NULL) {
-    //DEBUG_PRINT(("nothing in pagedir for address %p\n", p->uaddr));
-    pagedir_set_page(thread_current()->pagedir, p->uaddr, p->frame->base, p->writable);
-  }
+  page_map(p);
   ASSERT(p->page_current_loc == INFRAME);
   ASSERT(pagedir_get_page(thread_current()->pagedir, p->uaddr));
   frame_unlock(p->frame);
+  if (around)
+    page_fault_around(p, loc, write);
   return true;
 }
 
-/* Evicts page P.
-   P must have a locked frame.
+/* Handles a write to the present but read-only page containing
+   FAULT_ADDR.  If it is a writable page still shared copy-on-write
+   after fork(), gives it its own copy.
+   Returns true if the write may be retried, false if the page is
+   really read-only. */
+bool
+page_cow (void *fault_addr)
+{
+  struct page *p = page_for_addr(fault_addr, NULL);
+  if (!p || !p->writable)
+    return false;
+
+  frame_lock(p);
+  if (!p->frame) {
+    /* The first write to the zero page gets P a frame.  Otherwise
+       P was evicted meanwhile, and the retry faults it back in. */
+    if (p->page_current_loc == TOBEZEROED
+        && pagedir_get_page(thread_current()->pagedir, p->uaddr)) {
+      if (!do_page_in(p))
+        return false;
+      page_map(p);
+      frame_unlock(p->frame);
+    }
+    return true;
+  }
+  page_break_cow(p);
+  frame_unlock(p->frame);
+  return true;
+}
+
+/* Removes P's mapping, if any, from its owner's page directory,
+   first noting in P->dirty whether it was written through it. */
+static void
+page_unmap (struct page *p)
+{
+  uint32_t *pd = p->owner->pagedir;
+  if (!pagedir_get_page(pd, p->uaddr))
+    return;
+  if (pagedir_is_dirty(pd, p->uaddr))
+    p->dirty = true;
+  pagedir_clear_page(pd, p->uaddr);
+}
+
+/* Returns true if page A should come before page B in a swap
+   cluster: grouped by process, then in address order, so that a
+   process's adjacent pages land in adjacent swap slots. */
+static bool
+page_cluster_less (const struct page *a, const struct page *b)
+{
+  if (a->owner != b->owner)
+    return a->owner < b->owner;
+  return a->uaddr < b->uaddr;
+}
+
+/* Evicts the CNT pages in VICTIMS, at most SWAP_CLUSTER of them.
+   A writable page goes to swap only if it is dirty; otherwise it
+   drops back to its swap slot, file, or zeros, whichever it last
+   came from.  The dirty ones are written out together, to adjacent
+   swap slots.
+   Each page must have a locked frame.
    Return true if successful, false on failure. */
 bool
-page_out (struct page *p )
+page_out_cluster (struct page **victims, size_t cnt)
 {
-  //lock_acquire (&page_out_lock);
-  //DEBUG_PRINT(("calling page_out on page at %p\n", p->uaddr));
-  ASSERT(p->frame);
-  ASSERT(p->frame->lock.holder == thread_current());
-  ASSERT(p->page_current_loc == INFRAME);
-  ASSERT(p->frame->page == p);
-  if (!p->writable) {
-    //DEBUG_PRINT(("it is read only and therefore going to a file...\n", p->uaddr));
-    p -> page_current_loc = FROMFILE;
-  } else {
-    // DEBUG_PRINT(("it is not read only and therefore going to swap...\n", p->uaddr));
-    swap_out(p);
-    p -> page_current_loc = INSWAP;
+  struct page *dirty[SWAP_CLUSTER];
+  size_t dirty_cnt = 0;
+  size_t i, j;
+
+  ASSERT(cnt <= SWAP_CLUSTER);
+  for (i = 0; i < cnt; i++) {
+    struct page *p = victims[i];
+    //DEBUG_PRINT(("calling page_out on page at %p\n", p->uaddr));
+    ASSERT(p->frame);
+    ASSERT(p->frame->lock.holder == thread_current());
+    ASSERT(p->page_current_loc == INFRAME);
+    ASSERT(p->frame->page == p);
+
+    /* Unmap it first, so that it can't be written between checking
+       its dirty bit and copying it out. */
+    page_unmap(p);
+    if (!p->writable) {
+      //DEBUG_PRINT(("it is read only and therefore going to a file...\n", p->uaddr));
+      p -> page_current_loc = FROMFILE;
+    } else if (!p->dirty) {
+      /* Its last copy is still good, so just drop back to it. */
+      if (p->sector != SWAP_NONE)
+        p -> page_current_loc = INSWAP;
+      else
+        p -> page_current_loc = p->file ? FROMFILE : TOBEZEROED;
+    } else {
+      /* Insertion sort into swap order. */
+      for (j = dirty_cnt; j > 0 && page_cluster_less(p, dirty[j - 1]); j--)
+        dirty[j] = dirty[j - 1];
+      dirty[j] = p;
+      dirty_cnt++;
+    }
   }
-  //lock_release (&page_out_lock);
-  //DEBUG_PRINT(("did we make it thru this much of page_out %p\n", p->uaddr));
-  //pagedir_set_page(thread_current()->pagedir, p->uaddr, p->frame->base, p->writable);
-  //DEBUG_PRINT(("clearing page %p from the pagetable at frame base ...\n", p->uaddr, p->frame->base));
-  //DEBUG_PRINT(("page %p was in the pagetable at page %p...\n", p->uaddr, pagedir_get_page(thread_current()->pagedir, p->uaddr)));
-  if (pagedir_get_page(p->owner->pagedir, p->uaddr)) {
-    pagedir_clear_page(p->owner->pagedir, p->uaddr);
+
+  if (dirty_cnt > 0) {
+    // DEBUG_PRINT(("%d pages are going to swap...\n", dirty_cnt));
+    swap_out_cluster(dirty, dirty_cnt);
+    for (i = 0; i < dirty_cnt; i++) {
+      dirty[i] -> page_current_loc = INSWAP;
+      dirty[i]->dirty = false;
+    }
   }
 
-  frame_free(p->frame);
-  ASSERT(p->frame == NULL);
-  //ASSERT(pagedir_get_page(thread_current()->pagedir, p->uaddr) == NULL);
+  for (i = 0; i < cnt; i++) {
+    struct page *p = victims[i];
+    /* Anyone sharing the frame now finds the data where P's went. */
+    share_evict(p->frame);
+    frame_free(p->frame);
+    ASSERT(p->frame == NULL);
+  }
   return true;
 }
 
+/* Evicts page P.
+   P must have a locked frame.
+   Return true if successful, false on failure. */
+bool
+page_out (struct page *p)
+{
+  return page_out_cluster(&p, 1);
+}
+
+/* Copies PARENT's supplemental page table into the current
+   process, a newly forked child of PARENT whose page directory is
+   active.  PARENT must stay blocked until this returns.
+   Resident writable pages are shared copy-on-write and mapped
+   read-only in both processes, swapped-out pages share their swap
+   slot, and everything else is copied as a description to be
+   faulted in later.  File-backed pages are read from FILE, the
+   child's own handle on its executable.
+   Returns true if successful, false if memory ran out. */
+bool
+page_fork (struct thread *parent, struct file *file)
+{
+  struct thread *t = thread_current();
+  struct hash_iterator i;
+
+  ASSERT(t->supp_pt_initialized);
+  if (!parent->supp_pt_initialized)
+    return true;
+
+  hash_first(&i, &parent->supp_pt);
+  while (hash_next(&i)) {
+    struct page *pp = hash_entry(hash_cur(&i), struct page, hash_elem);
+    struct page *cp = page_allocate(pp->uaddr, !pp->writable);
+    struct frame *f;
+    bool success = true;
+
+    if (!cp)
+      return false;
+    cp->file = pp->file ? file : NULL;
+    cp->file_offset = pp->file_offset;
+    cp->file_bytes = pp->file_bytes;
+
+    /* Keep the parent's page from being evicted while we look. */
+    frame_lock(pp);
+    f = pp->frame;
+    if (!f) {
+      cp->page_current_loc = pp->page_current_loc;
+      if (cp->page_current_loc == INSWAP) {
+        cp->sector = pp->sector;
+        swap_dup(cp->sector);
+      }
+    } else if (!pp->writable) {
+      /* Read-only frames are shared through the shared-page table
+         on the child's first fault. */
+      cp->page_current_loc = pp->file ? FROMFILE : TOBEZEROED;
+    } else {
+      share_add(pp, cp);
+      /* The child has no copy of its own to fall back on. */
+      cp->dirty = true;
+      if (pagedir_get_page(parent->pagedir, pp->uaddr)) {
+        page_unmap(pp);
+        pagedir_set_page(parent->pagedir, pp->uaddr, f->base, false);
+      }
+      success = pagedir_set_page(t->pagedir, cp->uaddr, f->base, false);
+    }
+    if (f)
+      frame_unlock(f);
+    if (!success)
+      return false;
+  }
+  return true;
+}
+
+/* Returns true if P's accessed bit is set in its owner's page
+   directory, and clears it. */
+static bool
+page_test_accessed (struct page *p)
+{
+  uint32_t *pd = p->owner->pagedir;
+  bool accessed = pagedir_is_accessed(pd, p->uaddr);
+  if (accessed)
+    pagedir_set_accessed(pd, p->uaddr, false);
+  return accessed;
+}
+
 /* Returns true if page P's data has been accessed recently,
-   false otherwise.
+   false otherwise, and clears the accessed bits so that the next
+   call reports only newer accesses.  A shared frame counts as
+   accessed if any of the processes mapping it has touched it.
    P must have a frame locked into memory. */
 bool
 page_accessed_recently (struct page *p ) 
 {
-  return false;
+  struct frame *f = p->frame;
+  struct list_elem *e;
+  bool accessed = false;
+
+  ASSERT(f);
+  ASSERT(f->lock.holder == thread_current());
+  if (f->share_cnt == 0)
+    return page_test_accessed(p);
+
+  /* Clear every sharer's bit, not just up to the first one set. */
+  for (e = list_begin(&f->sharers); e != list_end(&f->sharers);
+       e = list_next(e))
+    if (page_test_accessed(list_entry(e, struct page, share_elem)))
+      accessed = true;
+  return accessed;
+}
+
+/* Returns true if page P can be evicted without writing its data
+   anywhere, because it can be read back from its file, its swap
+   slot, or zeros.
+   P must have a frame locked into memory. */
+bool
+page_is_clean (struct page *p)
+{
+  return !p->writable
+         || (!p->dirty && !pagedir_is_dirty(p->owner->pagedir, p->uaddr));
 }
 
 /* Adds a mapping for user virtual address VADDR to the page hash
@@ -231,6 +650,9 @@ page_allocate (void *vaddr, bool read_only)
    p->frame = NULL;
    p->owner = thread_current();
    p->page_current_loc = INIT;
+   p->sector = SWAP_NONE;
+   p->dirty = false;
+   p->ws_epoch = 0;
 
    struct hash *s_pt = &thread_current()->supp_pt;
    struct hash_elem *e = hash_insert (s_pt, &p->hash_elem);
@@ -317,15 +739,18 @@ page_lock (const void *addr , bool will_write, void* esp)
 
       DEBUG_PRINT(("about to put page %p in the pagetable at page %p...\n", p->uaddr, p->frame->base));
       //return pagedir_set_page(thread_current()->pagedir, p->uaddr, p->frame->base, p->writable);
-      if (pagedir_get_page(thread_current()->pagedir, p->uaddr) == NULL) {
-        DEBUG_PRINT(("nothing in pagedir for address %p\n", p->uaddr));
-        pagedir_set_page(thread_current()->pagedir, p->uaddr, p->frame->base, p->writable);
-      }
+      page_map(p);
       return true;
     
   } else {
     // step 2 is to copy it into the frame table
     ASSERT(pagedir_get_page(thread_current()->pagedir, p->uaddr));
+    /* The kernel is about to write to it, so it can't stay
+       copy-on-write. */
+    if (will_write) {
+      page_break_cow(p);
+      p->dirty = true;
+    }
     return true;
   }
 }
@@ -342,7 +767,7 @@ page_unlock (const void *addr)
     PANIC("we should be unlocking something that exists??");
   }
   ASSERT(p->frame);
-  ASSERT(p->frame->page == p);
+  ASSERT(p->frame->page == p || p->frame->share_cnt > 0);
   frame_unlock(p->frame);
   DEBUG_PRINT(("ESCAPED PAGE_UNLOCK\n"));
 }
@@ -21,16 +21,24 @@ struct page {
   bool writable;
   struct thread* owner;
 	struct hash_elem hash_elem;
-	uint32_t sector; // sector index
+	uint32_t sector; // swap slot holding a copy, or SWAP_NONE
+  bool dirty; // may differ from its swap slot, file, or zeros
+  struct list_elem share_elem; // element in frame's sharers, if shared
+  unsigned ws_epoch; // working-set sample it was last seen accessed in
 };
 
 static void destroy_page (struct hash_elem *p_, void *aux);
 void page_exit (void);
 struct page *page_for_addr (const void *address, void* esp);
 static bool do_page_in (struct page *p);
-bool page_in (void *fault_addr, void* esp);
+void page_init (void);
+bool page_in (void *fault_addr, bool write, void* esp);
 bool page_out (struct page *p);
+bool page_out_cluster (struct page **victims, size_t cnt);
+bool page_cow (void *fault_addr);
+bool page_fork (struct thread *parent, struct file *file);
 bool page_accessed_recently (struct page *p);
+bool page_is_clean (struct page *p);
 struct page * page_allocate (void *vaddr, bool read_only);
 void page_deallocate (void *vaddr);
 unsigned page_hash (const struct hash_elem *e, void *aux);
@@ -0,0 +1,260 @@
+#include "vm/share.h"
+#include <debug.h>
+#include "filesys/inode.h"
+#include "userprog/pagedir.h"
+#include "vm/swap.h"
+
+/*
+Sharing frames between processes
+
+Every process running the same executable maps the same text pages.
+Rather than giving each of them a private copy, a frame that holds a
+read-only page read straight from a file is entered in the shared-page
+table, keyed by the file's inode, the page's offset in it, and the
+number of bytes read from there.  A later fault on the same (inode,
+offset, length) maps that frame instead of reading the file again.
+The length matters because two segments can start in the same file
+page, each reading a different amount of it and zeroing the rest.
+
+fork() shares a process's resident writable pages with the child in
+the same way, except that such a frame has no inode and is not in the
+table.  It is mapped read-only everywhere, and a write fault gives the
+writer its own copy (see page_cow()).
+
+A shared frame keeps every page that maps it on its SHARERS list.  The
+frame's PAGE member is one of them and is the page eviction works on;
+evicting it unmaps the frame from every sharer, which then finds its
+data where F->page's went: back in the file or in the same swap slot.
+The frame is released only when the last sharer goes away.
+
+Lock order is a frame's lock, then share_lock.
+*/
+
+/* Shared frames, keyed by (inode, offset, length). */
+static struct hash shared_frames;
+
+/* Protects shared_frames and the sharing members of every frame. */
+static struct lock share_lock;
+
+static unsigned share_hash (const struct hash_elem *e, void *aux);
+static bool share_less (const struct hash_elem *a_, const struct hash_elem *b_,
+                        void *aux);
+
+/* Initializes the shared-page table. */
+void
+share_init (void)
+{
+  hash_init (&shared_frames, share_hash, share_less, NULL);
+  lock_init (&share_lock);
+}
+
+/* Returns true if P may share its frame with other processes. */
+static bool
+page_is_shareable (const struct page *p)
+{
+  return !p->writable && p->page_current_loc == FROMFILE && p->file != NULL;
+}
+
+/* Looks for a resident frame holding the same file data as P and,
+   if there is one, makes P one of its sharers.
+   Returns true with P's frame locked if successful,
+   false if P must be read in on its own. */
+bool
+share_page_in (struct page *p)
+{
+  struct frame key;
+  struct hash_elem *e;
+
+  ASSERT (p->frame == NULL);
+  if (!page_is_shareable (p))
+    return false;
+
+  key.inode = file_get_inode (p->file);
+  key.file_offset = p->file_offset;
+  key.file_bytes = p->file_bytes;
+  for (;;)
+    {
+      struct frame *f;
+
+      lock_acquire (&share_lock);
+      e = hash_find (&shared_frames, &key.share_elem);
+      lock_release (&share_lock);
+      if (e == NULL)
+        return false;
+      f = hash_entry (e, struct frame, share_elem);
+
+      /* The frame may be evicted or reused while we wait for it,
+         so look it up again once it is locked. */
+      lock_acquire (&f->lock);
+      lock_acquire (&share_lock);
+      if (f->share_cnt > 0 && f->inode == key.inode
+          && f->file_offset == key.file_offset
+          && f->file_bytes == key.file_bytes)
+        {
+          list_push_back (&f->sharers, &p->share_elem);
+          f->share_cnt++;
+          p->frame = f;
+          lock_release (&share_lock);
+          return true;
+        }
+      lock_release (&share_lock);
+      lock_release (&f->lock);
+    }
+}
+
+/* Publishes the frame of P, which must be locked and hold P's file
+   data, so that other processes can map it.  Does nothing if P is
+   not shareable or another frame already holds the same data. */
+void
+share_register (struct page *p)
+{
+  struct frame *f = p->frame;
+
+  ASSERT (f != NULL);
+  ASSERT (f->lock.holder == thread_current ());
+  ASSERT (f->share_cnt == 0);
+  if (!page_is_shareable (p))
+    return;
+
+  f->inode = file_get_inode (p->file);
+  f->file_offset = p->file_offset;
+  f->file_bytes = p->file_bytes;
+  lock_acquire (&share_lock);
+  if (hash_insert (&shared_frames, &f->share_elem) == NULL)
+    {
+      list_push_back (&f->sharers, &p->share_elem);
+      f->share_cnt = 1;
+    }
+  else
+    f->inode = NULL;
+  lock_release (&share_lock);
+}
+
+/* Makes P, which has no frame, another sharer of OWNER's frame.
+   OWNER's frame must be locked.  Used by fork() to share a
+   resident page with the child; it is up to the caller to map
+   the frame read-only in both processes. */
+void
+share_add (struct page *owner, struct page *p)
+{
+  struct frame *f = owner->frame;
+
+  ASSERT (f != NULL);
+  ASSERT (f->lock.holder == thread_current ());
+  ASSERT (p->frame == NULL);
+
+  lock_acquire (&share_lock);
+  if (f->share_cnt == 0)
+    {
+      list_push_back (&f->sharers, &owner->share_elem);
+      f->share_cnt = 1;
+    }
+  list_push_back (&f->sharers, &p->share_elem);
+  f->share_cnt++;
+  p->frame = f;
+  p->page_current_loc = INFRAME;
+  lock_release (&share_lock);
+}
+
+/* Removes P, whose frame must be locked, from its frame's sharers.
+   Returns true if other pages still map the frame, in which case
+   P no longer has a frame and the caller must only release the
+   frame's lock.  Returns false if the frame is now private to P
+   and may be freed. */
+bool
+share_detach (struct page *p)
+{
+  struct frame *f = p->frame;
+  bool still_shared;
+
+  ASSERT (f != NULL);
+  ASSERT (f->lock.holder == thread_current ());
+  if (f->share_cnt == 0)
+    return false;
+
+  lock_acquire (&share_lock);
+  list_remove (&p->share_elem);
+  still_shared = --f->share_cnt > 0;
+  if (still_shared)
+    {
+      if (f->page == p)
+        {
+          f->page = list_entry (list_front (&f->sharers),
+                                struct page, share_elem);
+          frame_recharge (p, f->page);
+        }
+      p->frame = NULL;
+    }
+  else
+    {
+      if (f->inode != NULL)
+        hash_delete (&shared_frames, &f->share_elem);
+      f->inode = NULL;
+      f->page = p;
+    }
+  lock_release (&share_lock);
+  return still_shared;
+}
+
+/* Unmaps locked frame F from every sharer except F->page and takes
+   it out of the shared-page table, leaving F private to F->page.
+   F->page must already have been written out, and the other
+   sharers are pointed at wherever it went. */
+void
+share_evict (struct frame *f)
+{
+  struct page *owner = f->page;
+
+  ASSERT (f->lock.holder == thread_current ());
+  if (f->share_cnt == 0)
+    return;
+
+  lock_acquire (&share_lock);
+  if (f->inode != NULL)
+    hash_delete (&shared_frames, &f->share_elem);
+  while (!list_empty (&f->sharers))
+    {
+      struct page *p = list_entry (list_pop_front (&f->sharers),
+                                   struct page, share_elem);
+      if (p == owner)
+        continue;
+      if (pagedir_get_page (p->owner->pagedir, p->uaddr))
+        pagedir_clear_page (p->owner->pagedir, p->uaddr);
+      p->frame = NULL;
+      p->page_current_loc = owner->page_current_loc;
+      p->dirty = false;
+      if (p->sector != SWAP_NONE)
+        swap_free (p);
+      if (p->page_current_loc == INSWAP)
+        {
+          p->sector = owner->sector;
+          swap_dup (p->sector);
+        }
+    }
+  f->share_cnt = 0;
+  f->inode = NULL;
+  lock_release (&share_lock);
+}
+
+/* Returns a hash value for the shared frame that E refers to. */
+static unsigned
+share_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct frame *f = hash_entry (e, struct frame, share_elem);
+  return hash_bytes (&f->inode, sizeof f->inode)
+         ^ hash_int (f->file_offset) ^ hash_int (f->file_bytes);
+}
+
+/* Returns true if shared frame A precedes shared frame B. */
+static bool
+share_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, share_elem);
+  const struct frame *b = hash_entry (b_, struct frame, share_elem);
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  if (a->file_offset != b->file_offset)
+    return a->file_offset < b->file_offset;
+  return a->file_bytes < b->file_bytes;
+}
@@ -0,0 +1,14 @@
+#ifndef VM_SHARE_H
+#define VM_SHARE_H
+
+#include <stdbool.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+
+void share_init (void);
+bool share_page_in (struct page *p);
+void share_register (struct page *p);
+void share_add (struct page *owner, struct page *p);
+bool share_detach (struct page *p);
+void share_evict (struct frame *f);
+#endif
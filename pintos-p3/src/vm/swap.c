@@ -1,6 +1,8 @@
 #include "swap.h"
 #include <stdio.h>
 #include "debug.h"
+#include "threads/malloc.h"
+#include "vm/zswap.h"
 
 #ifndef DEBUG_BULLSHIT
 #define DEBUG_BULLSHIT
@@ -30,6 +32,14 @@ and to attach a swap disk for a single run, use this option ‘--swap-size=n’
 // we just provide swap_init() for swap.c
 // the rest is your responsibility
 
+/* Number of pages referring to each swap slot.  A slot written
+   out for a copy-on-write frame is read back by every process
+   that shared the frame, and is released when the last one has
+   read it or gone away.  Protected by swap_lock. */
+static unsigned short *swap_refs;
+
+static void swap_release (uint32_t sector);
+
 /* Set up*/
 void
 swap_init (void)
@@ -45,72 +55,141 @@ swap_init (void)
                                  / PAGE_SECTORS);
   if (swap_bitmap == NULL)
     PANIC ("couldn't create swap bitmap");
+  swap_refs = calloc (bitmap_size (swap_bitmap), sizeof *swap_refs);
+  if (swap_refs == NULL && bitmap_size (swap_bitmap) > 0)
+    PANIC ("couldn't create swap reference counts");
+  zswap_init (bitmap_size (swap_bitmap));
   lock_init (&swap_lock);
 }
 
-/* Swaps in page P, which must have a locked frame
-   (and be swapped out). */
+/* Swaps in the CNT pages in PAGES, which must have locked frames
+   (and be swapped out) and sit in consecutive swap slots, in
+   order, so that they are read in one sweep over the disk; pages
+   held compressed in memory are decompressed instead.  Each page
+   keeps its swap slot, which stays a valid copy of the page until
+   the page is written, so that a clean page can be evicted again
+   without writing it. */
 void
-swap_in (struct page *p)
+swap_in_cluster (struct page **pages, size_t cnt)
 {
-  DEBUG_PRINT(("calling swap_in on page at %p\n", p->uaddr));
-  ASSERT(p);
-  ASSERT(p->frame);
-  ASSERT(p->frame->lock.holder == thread_current());
-  ASSERT(p->page_current_loc == INSWAP);
-    lock_acquire (&swap_lock);
-    ASSERT(p);
+  uint32_t first = pages[0]->sector;
+  size_t i;
+  int j;
+
+  ASSERT (cnt > 0 && cnt <= SWAP_CLUSTER);
+  for (i = 0; i < cnt; i++) {
+    struct page *p = pages[i];
+    DEBUG_PRINT(("calling swap_in on page at %p\n", p->uaddr));
     ASSERT(p->frame);
     ASSERT(p->frame->lock.holder == thread_current());
     ASSERT(p->page_current_loc == INSWAP);
-    uint32_t sector = p->sector;
-    DEBUG_PRINT(("coming from sector %d\n", sector));
-    void *c = p->frame->base;
-    int i;
-    for (i = 0; i < PAGE_SECTORS; i++) {
-      block_read (swap_device, sector * PAGE_SECTORS + i, c);
+    ASSERT(p->sector == first + i);
+  }
+
+  lock_acquire (&swap_lock);
+  DEBUG_PRINT(("coming from sectors %d..%d\n", first, first + cnt - 1));
+  for (i = 0; i < cnt; i++) {
+    uint8_t *c = pages[i]->frame->base;
+    if (zswap_load (first + i, c))
+      continue;
+    for (j = 0; j < PAGE_SECTORS; j++) {
+      block_read (swap_device, (first + i) * PAGE_SECTORS + j, c);
       c += BLOCK_SECTOR_SIZE;
     }
-    bitmap_reset (swap_bitmap, sector);
-    lock_release (&swap_lock);
-    p->sector = -1;
-    DEBUG_PRINT(("finished calling swap_in on page at %p\n", p->uaddr));
+  }
+  lock_release (&swap_lock);
 }
 
-/* Swaps out page P, which must have a locked frame. */
-void 
-swap_out (struct page *p) 
+/* Swaps out the CNT pages in PAGES, which must have locked frames,
+   to consecutive swap slots in order, so that they are written in
+   one sweep over the disk and can be read back together.  Pages
+   that compress well are kept in memory instead, leaving their
+   slots unwritten.  A single page rewrites its own swap slot in
+   place if it has one that no other page shares.  Otherwise the
+   pages give up any slots they had; if no run of CNT free slots is
+   left, each page goes wherever one fits. */
+void
+swap_out_cluster (struct page **pages, size_t cnt)
 {
-  DEBUG_PRINT(("calling swap_out on page at %p\n", p->uaddr));
-  ASSERT(p);
-  ASSERT(p->frame);
-  ASSERT(p->page_current_loc == INFRAME);
-  ASSERT(p->frame->lock.holder == thread_current());
-  //DEBUG_PRINT(("made it thru the asserts... %p\n", p->uaddr));
-    lock_acquire (&swap_lock);
-    ASSERT(p);
+  size_t first, i;
+  int j;
+
+  ASSERT (cnt > 0 && cnt <= SWAP_CLUSTER);
+  for (i = 0; i < cnt; i++) {
+    struct page *p = pages[i];
+    DEBUG_PRINT(("calling swap_out on page at %p\n", p->uaddr));
     ASSERT(p->frame);
     ASSERT(p->page_current_loc == INFRAME);
     ASSERT(p->frame->lock.holder == thread_current());
-    void *c = p->frame->base;
-    //DEBUG_PRINT(("<1>\n"));
-    //DEBUG_PRINT(("c: %p\n", c));
-    //DEBUG_PRINT(("bitmap at %p, size is %u\n", &swap_bitmap, bitmap_size(&swap_bitmap)));
-    size_t sector_num = bitmap_scan_and_flip (swap_bitmap, 0, 1, false);
-    if (sector_num == BITMAP_ERROR) PANIC("bitmap error\n");
-    p->sector = sector_num;
-    DEBUG_PRINT(("going to sector %d\n", sector_num));
-    //DEBUG_PRINT(("<2>\n"));
-    int i;
-    for (i = 0; i < PAGE_SECTORS; i++) {
-      //DEBUG_PRINT(("<2a>\n"));
-      block_write (swap_device, sector_num * PAGE_SECTORS + i, c);
-      //DEBUG_PRINT(("<2b>\n"));
+  }
+
+  lock_acquire (&swap_lock);
+  first = pages[0]->sector;
+  if (cnt > 1 || first == SWAP_NONE || swap_refs[first] > 1) {
+    for (i = 0; i < cnt; i++)
+      if (pages[i]->sector != SWAP_NONE) {
+        swap_release (pages[i]->sector);
+        pages[i]->sector = SWAP_NONE;
+      }
+    first = bitmap_scan_and_flip (swap_bitmap, 0, cnt, false);
+    if (first == BITMAP_ERROR) {
+      lock_release (&swap_lock);
+      if (cnt == 1)
+        PANIC("bitmap error\n");
+      for (i = 0; i < cnt; i++)
+        swap_out_cluster (&pages[i], 1);
+      return;
+    }
+    for (i = 0; i < cnt; i++) {
+      swap_refs[first + i] = 1;
+      pages[i]->sector = first + i;
+    }
+  }
+  DEBUG_PRINT(("going to sectors %d..%d\n", first, first + cnt - 1));
+  for (i = 0; i < cnt; i++) {
+    const uint8_t *c = pages[i]->frame->base;
+    if (zswap_store (first + i, c))
+      continue;
+    for (j = 0; j < PAGE_SECTORS; j++) {
+      block_write (swap_device, (first + i) * PAGE_SECTORS + j, c);
       c += BLOCK_SECTOR_SIZE;
-      //DEBUG_PRINT(("<2c>\n"));
     }
-    //DEBUG_PRINT(("<3>\n"));
-    
-    lock_release (&swap_lock);
-    DEBUG_PRINT(("finished calling swap_out on page at %p\n", p->uaddr));
+  }
+  lock_release (&swap_lock);
+}
+
+/* Adds a reference to swap slot SECTOR, for another page that
+   holds the same data. */
+void
+swap_dup (uint32_t sector)
+{
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (swap_bitmap, sector));
+  swap_refs[sector]++;
+  lock_release (&swap_lock);
+}
+
+/* Drops page P's reference to its swap slot, for a page that is
+   being destroyed or whose slot no longer holds its data. */
+void
+swap_free (struct page *p)
+{
+  ASSERT (p->sector != SWAP_NONE);
+  lock_acquire (&swap_lock);
+  swap_release (p->sector);
+  lock_release (&swap_lock);
+  p->sector = SWAP_NONE;
+}
+
+/* Drops a reference to swap slot SECTOR, freeing the slot when
+   none remain.  swap_lock must be held. */
+static void
+swap_release (uint32_t sector)
+{
+  ASSERT (swap_refs[sector] > 0);
+  if (--swap_refs[sector] == 0)
+    {
+      zswap_drop (sector);
+      bitmap_reset (swap_bitmap, sector);
+    }
 }
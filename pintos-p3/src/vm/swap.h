@@ -20,7 +20,15 @@ static struct lock swap_lock;
 /* Number of sectors per page. */
 #define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
 
+/* Most pages read or written in one swap transfer. */
+#define SWAP_CLUSTER 8
+
+/* A page's sector when it has no swap slot. */
+#define SWAP_NONE ((uint32_t) -1)
+
 void swap_init (void);
-void swap_in (struct page *p);
-void swap_out (struct page *p);
+void swap_in_cluster (struct page **pages, size_t cnt);
+void swap_out_cluster (struct page **pages, size_t cnt);
+void swap_dup (uint32_t sector);
+void swap_free (struct page *p);
 #endif
@@ -0,0 +1,319 @@
+#include "vm/zswap.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Compressed swap cache.
+
+   Before a page goes out to a swap slot on disk, swap.c offers it
+   here.  If it compresses to half a page or less, and there is room
+   in the pool, the compressed copy is kept in memory and the disk
+   slot is never written; reading the slot back decompresses it.
+   Incompressible pages, and any that arrive while the pool is full,
+   go to disk as before.  The copy belongs to the swap slot, so it
+   lives exactly as long as the slot's data: it is dropped when the
+   slot is freed or rewritten.
+
+   The compressor is a plain LZSS: a flag byte says which of the
+   next eight items are literal bytes and which are back-references
+   of 3 to 273 bytes into the page, found through a hash of the
+   next three bytes.  It does one pass with no searching, which is
+   enough to squeeze the zero runs and repeated values that make up
+   most of a swapped-out user page.
+
+   The pool is up to ZSWAP_PAGES kernel pages, each cut into
+   ZCHUNK_SIZE-byte chunks; a compressed page takes a run of
+   adjacent chunks in one pool page.  Pool pages are allocated as
+   needed and given back when they empty.
+
+   swap.c calls all of these functions with swap_lock held, which
+   also protects the compressor's scratch space. */
+
+/* Most kernel pages in the pool. */
+#define ZSWAP_PAGES 32
+
+/* Allocation unit within a pool page. */
+#define ZCHUNK_SIZE 128
+#define ZCHUNKS (PGSIZE / ZCHUNK_SIZE)
+
+/* Largest compressed page worth keeping. */
+#define ZSWAP_MAX (PGSIZE / 2)
+
+/* A page of the pool. */
+struct zpage
+  {
+    uint8_t *base;              /* Kernel page, or null if not allocated. */
+    uint32_t used;              /* Bit N set if chunk N is in use. */
+  };
+
+/* Where a swap slot's compressed copy is. */
+struct zslot
+  {
+    uint16_t len;               /* Compressed size, 0 if not in the pool. */
+    uint8_t page;               /* Index in pool. */
+    uint8_t chunk;              /* First chunk in that page. */
+  };
+
+static struct zpage pool[ZSWAP_PAGES];
+static struct zslot *zslots;    /* Indexed by swap slot. */
+static size_t zslot_cnt;        /* Number of swap slots. */
+
+/* Statistics. */
+static unsigned store_cnt;      /* Pages stored compressed. */
+static unsigned incompressible_cnt;  /* Pages that didn't shrink enough. */
+static unsigned overflow_cnt;   /* Pages that found the pool full. */
+static unsigned hit_cnt;        /* Slot reads served from the pool. */
+static unsigned miss_cnt;       /* Slot reads that went to disk. */
+static unsigned long long bytes_in;   /* Bytes before compression. */
+static unsigned long long bytes_out;  /* Bytes after compression. */
+
+/* LZSS parameters. */
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH (LZ_MIN_MATCH + 15 + 255)
+
+/* Compressor scratch space. */
+static uint16_t lz_table[1 << LZ_HASH_BITS]; /* 1 + last position seen. */
+static uint8_t zbuf[ZSWAP_MAX];             /* Compressed output. */
+
+static size_t lz_compress (const uint8_t *src, uint8_t *dst, size_t cap);
+static void lz_decompress (const uint8_t *src, uint8_t *dst);
+static bool pool_alloc (size_t len, struct zslot *);
+
+/* Initializes the cache for a swap device of SLOT_CNT slots. */
+void
+zswap_init (size_t slot_cnt)
+{
+  zslots = calloc (slot_cnt, sizeof *zslots);
+  if (zslots == NULL && slot_cnt > 0)
+    PANIC ("couldn't allocate compressed swap slots");
+  zslot_cnt = slot_cnt;
+}
+
+/* Tries to keep PAGE, the new contents of swap slot SLOT, in the
+   pool.  Returns true if successful, false if the page must be
+   written to disk instead.  Either way, any copy the slot had
+   before is dropped. */
+bool
+zswap_store (size_t slot, const void *page)
+{
+  struct zslot *z = &zslots[slot];
+  size_t len;
+
+  ASSERT (slot < zslot_cnt);
+  zswap_drop (slot);
+
+  len = lz_compress (page, zbuf, ZSWAP_MAX);
+  if (len == 0)
+    {
+      incompressible_cnt++;
+      return false;
+    }
+  if (!pool_alloc (len, z))
+    {
+      overflow_cnt++;
+      return false;
+    }
+  memcpy (pool[z->page].base + z->chunk * ZCHUNK_SIZE, zbuf, len);
+  store_cnt++;
+  bytes_in += PGSIZE;
+  bytes_out += len;
+  return true;
+}
+
+/* Reads swap slot SLOT into PAGE if the pool holds it, keeping the
+   compressed copy.  Returns true if successful, false if the slot
+   must be read from disk. */
+bool
+zswap_load (size_t slot, void *page)
+{
+  struct zslot *z = &zslots[slot];
+
+  ASSERT (slot < zslot_cnt);
+  if (z->len == 0)
+    {
+      miss_cnt++;
+      return false;
+    }
+  lz_decompress (pool[z->page].base + z->chunk * ZCHUNK_SIZE, page);
+  hit_cnt++;
+  return true;
+}
+
+/* Drops swap slot SLOT's compressed copy, if it has one. */
+void
+zswap_drop (size_t slot)
+{
+  struct zslot *z = &zslots[slot];
+  struct zpage *zp;
+  size_t n;
+
+  ASSERT (slot < zslot_cnt);
+  if (z->len == 0)
+    return;
+  zp = &pool[z->page];
+  n = DIV_ROUND_UP (z->len, ZCHUNK_SIZE);
+  zp->used &= ~(((1u << n) - 1) << z->chunk);
+  if (zp->used == 0)
+    {
+      palloc_free_page (zp->base);
+      zp->base = NULL;
+    }
+  z->len = 0;
+}
+
+/* Prints compressed swap statistics. */
+void
+zswap_print_stats (void)
+{
+  printf ("Swap: %u pages compressed to %llu%%, %u incompressible, "
+          "%u overflowed; %u reads from memory, %u from disk\n",
+          store_cnt, bytes_in > 0 ? bytes_out * 100 / bytes_in : 0,
+          incompressible_cnt, overflow_cnt, hit_cnt, miss_cnt);
+}
+
+/* Finds LEN bytes of room in the pool, adding a page to it if
+   need be, and records where in *Z.  Returns false if the pool is
+   full. */
+static bool
+pool_alloc (size_t len, struct zslot *z)
+{
+  size_t n = DIV_ROUND_UP (len, ZCHUNK_SIZE);
+  uint32_t mask = (1u << n) - 1;
+  size_t i, c;
+
+  ASSERT (n < ZCHUNKS);
+  for (i = 0; i < ZSWAP_PAGES; i++)
+    {
+      struct zpage *zp = &pool[i];
+
+      if (zp->base == NULL)
+        {
+          zp->base = palloc_get_page (0);
+          if (zp->base == NULL)
+            return false;
+          zp->used = 0;
+        }
+      for (c = 0; c + n <= ZCHUNKS; c++)
+        if ((zp->used & (mask << c)) == 0)
+          {
+            zp->used |= mask << c;
+            z->page = i;
+            z->chunk = c;
+            z->len = len;
+            return true;
+          }
+    }
+  return false;
+}
+
+/* Returns a hash of the 3 bytes at P. */
+static inline unsigned
+lz_hash (const uint8_t *p)
+{
+  uint32_t x = p[0] | p[1] << 8 | p[2] << 16;
+  return (x * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Compresses the page at SRC into DST, which has room for CAP
+   bytes.  Returns the compressed size, or 0 if it would not fit. */
+static size_t
+lz_compress (const uint8_t *src, uint8_t *dst, size_t cap)
+{
+  size_t in = 0, out = 0;
+  size_t flag_pos = 0;
+  int flag_bit = 8;
+
+  memset (lz_table, 0, sizeof lz_table);
+  while (in < PGSIZE)
+    {
+      size_t len = 0, off = 0;
+
+      if (flag_bit == 8)
+        {
+          if (out >= cap)
+            return 0;
+          flag_pos = out++;
+          dst[flag_pos] = 0;
+          flag_bit = 0;
+        }
+
+      if (in + LZ_MIN_MATCH <= PGSIZE)
+        {
+          unsigned h = lz_hash (src + in);
+          size_t cand = lz_table[h];
+
+          lz_table[h] = in + 1;
+          if (cand != 0)
+            {
+              size_t max = PGSIZE - in < LZ_MAX_MATCH
+                           ? PGSIZE - in : LZ_MAX_MATCH;
+              cand--;
+              while (len < max && src[cand + len] == src[in + len])
+                len++;
+              off = in - cand;
+            }
+        }
+
+      if (len >= LZ_MIN_MATCH)
+        {
+          size_t code = len - LZ_MIN_MATCH;
+
+          if (out + 3 > cap)
+            return 0;
+          dst[flag_pos] |= 1 << flag_bit;
+          dst[out++] = (off - 1) >> 4;
+          dst[out++] = ((off - 1) & 0xf) << 4 | (code < 15 ? code : 15);
+          if (code >= 15)
+            dst[out++] = code - 15;
+          in += len;
+        }
+      else
+        {
+          if (out >= cap)
+            return 0;
+          dst[out++] = src[in++];
+        }
+      flag_bit++;
+    }
+  return out;
+}
+
+/* Decompresses SRC, produced by lz_compress(), into the page at
+   DST. */
+static void
+lz_decompress (const uint8_t *src, uint8_t *dst)
+{
+  size_t out = 0;
+  unsigned flags = 0;
+  int flag_bit = 8;
+
+  while (out < PGSIZE)
+    {
+      if (flag_bit == 8)
+        {
+          flags = *src++;
+          flag_bit = 0;
+        }
+      if (flags & (1u << flag_bit))
+        {
+          size_t off = (src[0] << 4 | src[1] >> 4) + 1;
+          size_t n = (src[1] & 0xf) + LZ_MIN_MATCH;
+
+          if ((src[1] & 0xf) == 15)
+            n += src[2];
+          src += (src[1] & 0xf) == 15 ? 3 : 2;
+          ASSERT (off <= out && out + n <= PGSIZE);
+          for (; n > 0; n--, out++)
+            dst[out] = dst[out - off];
+        }
+      else
+        dst[out++] = *src++;
+      flag_bit++;
+    }
+}
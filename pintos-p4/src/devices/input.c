@@ -41,6 +41,28 @@ input_getc (void)
   return key;
 }
 
+/* Retrieves up to SIZE keys from the input buffer into KEYS,
+   waiting for the first key if none has been pressed but not for
+   any after it.  Returns the number of keys retrieved. */
+size_t
+input_getbuf (uint8_t *keys, size_t size) 
+{
+  enum intr_level old_level;
+  size_t cnt;
+
+  old_level = intr_disable ();
+  for (cnt = 0; cnt < size; cnt++)
+    {
+      if (cnt > 0 && intq_empty (&buffer))
+        break;
+      keys[cnt] = intq_getc (&buffer);
+    }
+  serial_notify ();
+  intr_set_level (old_level);
+
+  return cnt;
+}
+
 /* Returns true if the input buffer is full,
    false otherwise.
    Interrupts must be off. */
@@ -1,5 +1,6 @@
 #include "devices/serial.h"
 #include <debug.h>
+#include <stdio.h>
 #include "devices/input.h"
 #include "devices/intq.h"
 #include "devices/timer.h"
@@ -44,15 +45,45 @@
 /* MODEM Control Register. */
 #define MCR_OUT2 0x08           /* Output line 2. */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable transmit and receive FIFOs. */
+#define FCR_CLEAR_RX 0x02       /* Discard contents of receive FIFO. */
+#define FCR_CLEAR_TX 0x04       /* Discard contents of transmit FIFO. */
+
+/* Interrupt Identification Register bits. */
+#define IIR_FIFO 0xc0           /* Both set if FIFOs are enabled. */
+
 /* Line Status Register. */
 #define LSR_DR 0x01             /* Data Ready: received data byte is in RBR. */
+#define LSR_OE 0x02             /* Overrun Error: received byte lost. */
 #define LSR_THRE 0x20           /* THR Empty. */
+
+/* Depth of the 16550A's transmit FIFO, in bytes. */
+#define XMIT_FIFO_SIZE 16
+
+/* Size of the transmit queue, in bytes.  Output beyond what the
+   queue holds makes writers wait (or, with interrupts off,
+   busy-wait), so the default is generous; override it with
+   -DSERIAL_TXQ_SIZE=N. */
+#ifndef SERIAL_TXQ_SIZE
+#define SERIAL_TXQ_SIZE 4096
+#endif
 
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
 /* Data to be transmitted. */
 static struct intq txq;
+static uint8_t txq_buf[SERIAL_TXQ_SIZE];
+
+/* Number of bytes the transmitter accepts each time THR empties:
+   XMIT_FIFO_SIZE if the FIFO is working, otherwise 1. */
+static int xmit_burst = 1;
+
+/* Statistics. */
+static long long tx_stall_cnt;  /* Writers that waited for queue space. */
+static long long tx_poll_cnt;   /* Bytes sent by busy-waiting. */
+static long long rx_overrun_cnt; /* Receive overruns (bytes lost). */
 
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
@@ -71,7 +102,7 @@ init_poll (void)
   outb (FCR_REG, 0);                    /* Disable FIFO. */
   set_serial (9600);                    /* 9.6 kbps, N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
-  intq_init (&txq);
+  intq_init_buf (&txq, txq_buf, sizeof txq_buf);
   mode = POLL;
 } 
 
@@ -88,6 +119,16 @@ serial_init_queue (void)
   ASSERT (mode == POLL);
 
   intr_register_ext (0x20 + 4, serial_interrupt, "serial");
+
+  /* Turn on the FIFOs, so that each transmit interrupt can send a
+     burst of bytes.  An 8250 or 16450 has no FIFO, which shows up
+     as IIR_FIFO staying clear. */
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR_RX | FCR_CLEAR_TX);
+  if ((inb (IIR_REG) & IIR_FIFO) == IIR_FIFO)
+    xmit_burst = XMIT_FIFO_SIZE;
+  else
+    outb (FCR_REG, 0);
+
   mode = QUEUE;
   old_level = intr_disable ();
   write_ier ();
@@ -120,7 +161,10 @@ serial_putc (uint8_t byte)
              That's impolite, so we'll send a character via
              polling instead. */
           putc_poll (intq_getc (&txq)); 
+          tx_poll_cnt++;
         }
+      else if (intq_full (&txq))
+        tx_stall_cnt++;
 
       intq_putc (&txq, byte); 
       write_ier ();
@@ -129,6 +173,50 @@ serial_putc (uint8_t byte)
   intr_set_level (old_level);
 }
 
+/* Sends the N bytes in BUFFER to the serial port.  Equivalent to
+   calling serial_putc() on each byte, but disables interrupts and
+   updates the interrupt enable register once for the whole buffer
+   rather than once per byte. */
+void
+serial_putbuf (const uint8_t *buffer, size_t n) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (mode != QUEUE)
+    {
+      if (mode == UNINIT)
+        init_poll ();
+      while (n-- > 0)
+        putc_poll (*buffer++);
+    }
+  else 
+    {
+      while (n-- > 0) 
+        {
+          if (intq_full (&txq)) 
+            {
+              if (old_level == INTR_OFF)
+                {
+                  putc_poll (intq_getc (&txq));
+                  tx_poll_cnt++;
+                }
+              else
+                {
+                  tx_stall_cnt++;
+                  /* intq_putc() will wait for the transmit
+                     interrupt to drain the queue, so make sure it
+                     is enabled. */
+                  write_ier ();
+                }
+            }
+          intq_putc (&txq, *buffer++);
+        }
+      write_ier ();
+    }
+
+  intr_set_level (old_level);
+}
+
 /* Flushes anything in the serial buffer out the port in polling
    mode. */
 void
@@ -140,6 +228,14 @@ serial_flush (void)
   intr_set_level (old_level);
 }
 
+/* Prints serial port statistics. */
+void
+serial_print_stats (void) 
+{
+  printf ("Serial: %lld stalls, %lld bytes polled, %lld receive overruns\n",
+          tx_stall_cnt, tx_poll_cnt, rx_overrun_cnt);
+}
+
 /* The fullness of the input buffer may have changed.  Reassess
    whether we should block receive interrupts.
    Called by the input buffer routines when characters are added
@@ -209,19 +305,31 @@ putc_poll (uint8_t byte)
 static void
 serial_interrupt (struct intr_frame *f UNUSED) 
 {
+  uint8_t lsr;
+
   /* Inquire about interrupt in UART.  Without this, we can
      occasionally miss an interrupt running under QEMU. */
   inb (IIR_REG);
 
   /* As long as we have room to receive a byte, and the hardware
      has a byte for us, receive a byte.  */
-  while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
-    input_putc (inb (RBR_REG));
+  while (((lsr = inb (LSR_REG)) & LSR_DR) != 0 && !input_full ())
+    {
+      if (lsr & LSR_OE)
+        rx_overrun_cnt++;
+      input_putc (inb (RBR_REG));
+    }
+  if (lsr & LSR_OE)
+    rx_overrun_cnt++;
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
+  /* Once the transmitter is empty it can take a whole FIFO's
+     worth of bytes without our checking again. */
   while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+    {
+      int burst = xmit_burst;
+      while (burst-- > 0 && !intq_empty (&txq))
+        outb (THR_REG, intq_getc (&txq));
+    }
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
@@ -135,6 +135,7 @@ print_stats (void)
   block_print_stats ();
 #endif
   console_print_stats ();
+  serial_print_stats ();
   kbd_print_stats ();
 #ifdef USERPROG
   exception_print_stats ();
@@ -27,6 +27,8 @@ static size_t cx, cy;
 static uint8_t (*fb)[COL_CNT][2];
 
 static void clear_row (size_t y);
+static void scroll (size_t lines);
+static void put_span (const char *, size_t n);
 static void cls (void);
 static void newline (void);
 static void move_cursor (void);
@@ -102,6 +104,114 @@ vga_putc (int c)
   intr_set_level (old_level);
 }
 
+/* Writes the N characters in BUFFER to the VGA text display,
+   interpreting control characters as vga_putc() does.  Scrolls at
+   most once for each run of characters between form feeds and
+   bells, and updates the hardware cursor only at the end, so
+   large writes cost far less than one vga_putc() per
+   character. */
+void
+vga_putbuf (const char *buffer, size_t n)
+{
+  enum intr_level old_level = intr_disable ();
+
+  init ();
+
+  while (n > 0)
+    {
+      /* Form feeds and bells go through vga_putc(): the first
+         discards the screen and the second must turn interrupts
+         back on. */
+      size_t span = 0;
+      while (span < n && buffer[span] != '\f' && buffer[span] != '\a')
+        span++;
+      put_span (buffer, span);
+      buffer += span;
+      n -= span;
+      if (n > 0)
+        {
+          intr_set_level (old_level);
+          vga_putc (*buffer++);
+          n--;
+          intr_disable ();
+        }
+    }
+  move_cursor ();
+
+  intr_set_level (old_level);
+}
+
+/* Writes the N characters in BUFFER, none of which is a form
+   feed or bell, starting at the cursor.  A first pass finds how
+   far the text runs below the bottom of the screen, so that the
+   screen can be scrolled once by that many lines; a second pass
+   then stores the characters, dropping any that have already
+   scrolled off the top.  Leaves the hardware cursor alone. */
+static void
+put_span (const char *buffer, size_t n) 
+{
+  int x, y, max_y;
+  size_t i;
+
+  /* Find the lowest row written. */
+  x = cx;
+  y = max_y = cy;
+  for (i = 0; i < n; i++) 
+    {
+      switch (buffer[i]) 
+        {
+        case '\n': x = 0; y++; break;
+        case '\b': if (x > 0) x--; break;
+        case '\r': x = 0; break;
+        case '\t':
+          x = ROUND_UP (x + 1, 8);
+          if (x >= COL_CNT)
+            x = 0, y++;
+          break;
+        default:
+          if (++x >= COL_CNT)
+            x = 0, y++;
+          break;
+        }
+      if (y > max_y)
+        max_y = y;
+    }
+  if (max_y < ROW_CNT)
+    max_y = ROW_CNT - 1;
+  scroll (max_y - (ROW_CNT - 1));
+
+  /* Store the characters.  Rows above the top of the screen have
+     already scrolled away. */
+  x = cx;
+  y = (int) cy - (max_y - (ROW_CNT - 1));
+  for (i = 0; i < n; i++) 
+    {
+      char c = buffer[i];
+      switch (c) 
+        {
+        case '\n': x = 0; y++; break;
+        case '\b': if (x > 0) x--; break;
+        case '\r': x = 0; break;
+        case '\t':
+          x = ROUND_UP (x + 1, 8);
+          if (x >= COL_CNT)
+            x = 0, y++;
+          break;
+        default:
+          if (y >= 0) 
+            {
+              fb[y][x][0] = c;
+              fb[y][x][1] = GRAY_ON_BLACK;
+            }
+          if (++x >= COL_CNT)
+            x = 0, y++;
+          break;
+        }
+    }
+  cx = x;
+  cy = y;
+}
+
 /* Clears the screen and moves the cursor to the upper left. */
 static void
 cls (void)
@@ -139,11 +249,26 @@ newline (void)
   if (cy >= ROW_CNT)
     {
       cy = ROW_CNT - 1;
-      memmove (&fb[0], &fb[1], sizeof fb[0] * (ROW_CNT - 1));
-      clear_row (ROW_CNT - 1);
+      scroll (1);
     }
 }
 
+/* Scrolls the screen upward by LINES lines, clearing the rows
+   uncovered at the bottom.  Does not move the cursor. */
+static void
+scroll (size_t lines) 
+{
+  size_t y;
+
+  if (lines == 0)
+    return;
+  if (lines > ROW_CNT)
+    lines = ROW_CNT;
+  memmove (&fb[0], &fb[lines], sizeof fb[0] * (ROW_CNT - lines));
+  for (y = ROW_CNT - lines; y < ROW_CNT; y++)
+    clear_row (y);
+}
+
 /* Moves the hardware cursor to (cx,cy). */
 static void
 move_cursor (void) 
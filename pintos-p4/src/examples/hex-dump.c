@@ -11,6 +11,9 @@ main (int argc, char *argv[])
   bool success = true;
   int i;
   
+  /* Dumps are long; write them a buffer at a time, not a line. */
+  setvbuf (stdout, NULL, _IOFBF, 0);
+
   for (i = 1; i < argc; i++) 
     {
       int fd = open (argv[i]);
@@ -3,8 +3,15 @@
 #include <string.h>
 #include <syscall.h>
 
+/* Maximum number of arguments to a command. */
+#define MAX_ARGS 16
+
+/* Maximum number of commands in a pipeline. */
+#define MAX_STAGES 4
+
 static void read_line (char line[], size_t);
 static bool backspace (char **pos, char line[]);
+static void run (const char *command);
 
 int
 main (void)
@@ -31,19 +38,175 @@ main (void)
           /* Empty command. */
         }
       else
-        {
-          pid_t pid = exec (command);
-          if (pid != PID_ERROR)
-            printf ("\"%s\": exit code %d\n", command, wait (pid));
-          else
-            printf ("exec failed\n");
-        }
+        run (command);
     }
 
   printf ("Shell exiting.");
   return EXIT_SUCCESS;
 }
 
+/* One program in a pipeline. */
+struct stage
+  {
+    char *argv[MAX_ARGS + 1];           /* Program name and arguments. */
+    struct spawn_action redirs[2];      /* "<" and ">" redirections. */
+    int redir_cnt;
+  };
+
+/* Parses TEXT, a program name followed by its arguments and any
+   redirections, into S.  Returns false after printing a message
+   if TEXT is malformed. */
+static bool
+parse_stage (char *text, struct stage *s)
+{
+  char *token, *save_ptr;
+  int argc = 0;
+
+  s->redir_cnt = 0;
+  for (token = strtok_r (text, " ", &save_ptr); token != NULL;
+       token = strtok_r (NULL, " ", &save_ptr))
+    {
+      if (*token == '<' || *token == '>')
+        {
+          struct spawn_action *a = &s->redirs[s->redir_cnt];
+          char *file = token + 1;
+
+          if (*file == '\0')
+            file = strtok_r (NULL, " ", &save_ptr);
+          if (file == NULL || s->redir_cnt >= 2)
+            {
+              printf ("bad redirection\n");
+              return false;
+            }
+          a->op = SPAWN_OPEN;
+          a->fd = *token == '<' ? STDIN_FILENO : STDOUT_FILENO;
+          a->path = file;
+          s->redir_cnt++;
+        }
+      else if (argc < MAX_ARGS)
+        s->argv[argc++] = token;
+      else
+        {
+          printf ("too many arguments\n");
+          return false;
+        }
+    }
+  s->argv[argc] = NULL;
+  return true;
+}
+
+/* Empties, or creates, the files that stage S's output is
+   redirected to, just before S is started, so that a command that
+   fails to parse leaves them alone.  Returns false on failure. */
+static bool
+create_outputs (const struct stage *s)
+{
+  int i;
+
+  for (i = 0; i < s->redir_cnt; i++)
+    if (s->redirs[i].fd == STDOUT_FILENO)
+      {
+        remove (s->redirs[i].path);
+        if (!create (s->redirs[i].path, 0))
+          {
+            printf ("\"%s\": create failed\n", s->redirs[i].path);
+            return false;
+          }
+      }
+  return true;
+}
+
+/* Runs COMMAND and waits for it to finish.  COMMAND is a pipeline
+   of programs separated by "|", each a program name followed by
+   its arguments.  Each program's output feeds the next one's
+   input through a pipe.  "< FILE" and "> FILE" redirect a
+   program's input and output.  The kernel sets up all of these
+   as part of starting each program. */
+static void
+run (const char *command)
+{
+  char line[80];
+  struct stage stages[MAX_STAGES];
+  pid_t pids[MAX_STAGES];
+  int stage_cnt = 0, started, i;
+  int in_fd = -1;
+  char *text, *save_ptr;
+
+  strlcpy (line, command, sizeof line);
+  for (text = strtok_r (line, "|", &save_ptr); text != NULL;
+       text = strtok_r (NULL, "|", &save_ptr))
+    {
+      if (stage_cnt >= MAX_STAGES)
+        {
+          printf ("too many commands in pipeline\n");
+          return;
+        }
+      if (!parse_stage (text, &stages[stage_cnt]))
+        return;
+      if (stages[stage_cnt].argv[0] == NULL)
+        {
+          if (strchr (command, '|') != NULL)
+            printf ("bad pipeline\n");
+          return;
+        }
+      stage_cnt++;
+    }
+  if (stage_cnt == 0)
+    return;
+
+  for (started = 0; started < stage_cnt; started++)
+    {
+      struct stage *s = &stages[started];
+      struct spawn_action actions[4];
+      int action_cnt = 0;
+      int fds[2] = { -1, -1 };
+
+      if (!create_outputs (s))
+        break;
+      if (started + 1 < stage_cnt && !pipe (fds))
+        {
+          printf ("pipe failed\n");
+          break;
+        }
+
+      /* Connect the pipes first so that explicit redirections
+         override them. */
+      if (in_fd >= 0)
+        {
+          actions[action_cnt].op = SPAWN_DUP2;
+          actions[action_cnt].fd = STDIN_FILENO;
+          actions[action_cnt++].src_fd = in_fd;
+        }
+      if (fds[1] >= 0)
+        {
+          actions[action_cnt].op = SPAWN_DUP2;
+          actions[action_cnt].fd = STDOUT_FILENO;
+          actions[action_cnt++].src_fd = fds[1];
+        }
+      for (i = 0; i < s->redir_cnt; i++)
+        actions[action_cnt++] = s->redirs[i];
+
+      pids[started] = spawn (s->argv[0], s->argv, actions, action_cnt);
+      if (pids[started] == PID_ERROR)
+        printf ("\"%s\": exec failed\n", s->argv[0]);
+
+      /* Only the children keep pipe ends open, so that each reader
+         sees end of file once its writer exits. */
+      if (in_fd >= 0)
+        close (in_fd);
+      if (fds[1] >= 0)
+        close (fds[1]);
+      in_fd = fds[0];
+    }
+  if (in_fd >= 0)
+    close (in_fd);
+
+  for (i = 0; i < started; i++)
+    if (pids[i] != PID_ERROR)
+      printf ("\"%s\": exit code %d\n",
+              stage_cnt == 1 ? command : stages[i].argv[0], wait (pids[i]));
+}
+
 /* Reads a line of input from the user into LINE, which has room
    for SIZE bytes.  Handles backspace and Ctrl+U in the ways
    expected by Unix users.  On return, LINE will always be
@@ -55,6 +218,10 @@ read_line (char line[], size_t size)
   for (;;)
     {
       char c;
+
+      /* stdout is line-buffered and raw reads don't flush it, so
+         push out the prompt and the echo so far. */
+      fflush (stdout);
       read (STDIN_FILENO, &c, 1);
 
       switch (c) 
@@ -133,6 +133,63 @@ file_write_at (struct file *file, const void *buffer, off_t size,
   return inode_write_at (file->inode, buffer, size, file_ofs, false);
 }
 
+/* Copies up to SIZE bytes from SRC, starting at SRC's current
+   position, into DST at DST's current position.  The data moves
+   one sector at a time through a kernel buffer, so no user memory
+   is involved.  After the first chunk the source offset stays
+   sector-aligned, so every read touches a single data block.
+   Returns the number of bytes actually copied, which may be less
+   than SIZE if end of SRC is reached or a write comes up short, or
+   -1 if no buffer could be allocated or SRC and DST are the same
+   file and the two ranges overlap, including when they are the
+   same struct file.
+   Advances both files' positions by the number of bytes copied. */
+off_t
+file_copy (struct file *dst, struct file *src, off_t size)
+{
+  uint8_t *buffer;
+  off_t bytes_copied = 0;
+
+  ASSERT (dst != NULL);
+  ASSERT (src != NULL);
+
+  /* Copying within a file would read back what it just wrote. */
+  if (src->inode == dst->inode && size > 0
+      && (src->pos > dst->pos ? src->pos - dst->pos
+                              : dst->pos - src->pos) < size)
+    return -1;
+
+  buffer = malloc (BLOCK_SECTOR_SIZE);
+  if (buffer == NULL)
+    return -1;
+
+  while (size > 0)
+    {
+      off_t chunk_size = BLOCK_SECTOR_SIZE - src->pos % BLOCK_SECTOR_SIZE;
+      off_t bytes_read, bytes_written;
+
+      if (chunk_size > size)
+        chunk_size = size;
+      bytes_read = inode_read_at (src->inode, buffer, chunk_size, src->pos);
+      if (bytes_read <= 0)
+        break;
+      bytes_written = inode_write_at (dst->inode, buffer, bytes_read,
+                                      dst->pos, false);
+      if (bytes_written <= 0)
+        break;
+
+      /* Advance. */
+      src->pos += bytes_written;
+      dst->pos += bytes_written;
+      bytes_copied += bytes_written;
+      size -= bytes_written;
+      if (bytes_written < bytes_read)
+        break;
+    }
+  free (buffer);
+  return bytes_copied;
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
@@ -73,6 +73,7 @@ struct inode
     struct condition no_writers_cond;
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
     int writer_cnt;
+    unsigned write_cnt;                 /* Number of writes since opened. */
   };
 
 /* Returns the block device sector that contains byte offset POS
@@ -179,6 +180,7 @@ inode_open (block_sector_t sector)
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->writer_cnt = 0;
+  inode->write_cnt = 0;
   inode->removed = false;
   lock_init(&(inode->deny_write_lock));
   lock_init(&(inode->lock));
@@ -208,6 +210,22 @@ inode_get_opencnt (const struct inode *inode)
   return inode->open_cnt;
 }
 
+/* Returns the number of writes that have changed INODE's data
+   since it was opened.  As long as INODE stays open, a change in
+   the count shows that its contents may have changed. */
+unsigned
+inode_write_cnt (const struct inode *inode)
+{
+  return inode->write_cnt;
+}
+
+/* Returns true if INODE has been removed. */
+bool
+inode_is_removed (const struct inode *inode)
+{
+  return inode->removed;
+}
+
 /* Returns INODE's inode number. */
 block_sector_t
 inode_get_inumber (const struct inode *inode)
@@ -530,6 +548,8 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   extend_file (inode, offset + size);
 
   lock_acquire (&inode->deny_write_lock);
+  if (bytes_written > 0)
+    inode->write_cnt++;
   if (--inode->writer_cnt == 0)
     cond_signal (&inode->no_writers_cond, &inode->deny_write_lock);
   lock_release (&inode->deny_write_lock);
@@ -21,6 +21,8 @@ struct inode *inode_reopen (struct inode *);
 enum inode_type inode_get_type (const struct inode *);
 block_sector_t inode_get_inumber (const struct inode *);
 int inode_get_opencnt (const struct inode *);
+unsigned inode_write_cnt (const struct inode *);
+bool inode_is_removed (const struct inode *);
 void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
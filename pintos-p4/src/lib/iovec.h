@@ -0,0 +1,18 @@
+#ifndef __LIB_IOVEC_H
+#define __LIB_IOVEC_H
+
+/* Scatter/gather buffer descriptor, shared between user programs
+   and the kernel for the readv() and writev() system calls. */
+
+#include <stddef.h>
+
+/* Maximum number of buffers accepted by one readv() or writev(). */
+#define IOV_MAX 64
+
+struct iovec
+  {
+    void *iov_base;             /* Start of buffer. */
+    size_t iov_len;             /* Size of buffer in bytes. */
+  };
+
+#endif /* lib/iovec.h */
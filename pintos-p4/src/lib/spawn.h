@@ -0,0 +1,35 @@
+#ifndef __LIB_SPAWN_H
+#define __LIB_SPAWN_H
+
+/* File descriptor set-up for the spawn() system call, shared
+   between user programs and the kernel.
+
+   A new process starts out with only the console, on fds 0 and 1.
+   spawn() applies a list of actions to the child's fd table, in
+   order, after loading the program and before it starts running,
+   so a parent can redirect a child's input and output without any
+   cooperation from the child. */
+
+/* Maximum number of actions accepted by one spawn(). */
+#define SPAWN_ACTIONS_MAX 8
+
+/* Highest child descriptor an action may set up. */
+#define SPAWN_FD_MAX 63
+
+/* Action types. */
+enum spawn_op
+  {
+    SPAWN_OPEN,                 /* Open PATH as the child's FD. */
+    SPAWN_DUP2                  /* Give the child's FD a copy of the
+                                   parent's SRC_FD. */
+  };
+
+struct spawn_action
+  {
+    int op;                     /* A spawn_op. */
+    int fd;                     /* Child's descriptor to set up. */
+    int src_fd;                 /* SPAWN_DUP2: parent's descriptor. */
+    const char *path;           /* SPAWN_OPEN: file to open. */
+  };
+
+#endif /* lib/spawn.h */
@@ -28,7 +28,19 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_COPY_FILE_RANGE,        /* Copy bytes between two files. */
+    SYS_PREAD,                  /* Read from a file at a given offset. */
+    SYS_PWRITE,                 /* Write to a file at a given offset. */
+    SYS_READV,                  /* Read from a file into several buffers. */
+    SYS_WRITEV,                 /* Write to a file from several buffers. */
+    SYS_URING_SETUP,            /* Register a submission/completion ring. */
+    SYS_URING_ENTER,            /* Submit ring entries and reap completions. */
+    SYS_SPAWN,                  /* Start a process with fd set-up. */
+    SYS_PIPE,                   /* Create a pipe. */
+    SYS_WAIT_ANY                /* Wait for any child process to die. */
   };
 
 #endif /* lib/syscall-nr.h */
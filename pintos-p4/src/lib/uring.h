@@ -0,0 +1,63 @@
+#ifndef __LIB_URING_H
+#define __LIB_URING_H
+
+/* Submission/completion ring for batched asynchronous system
+   calls, shared between user programs and the kernel.
+
+   A process registers a struct uring with uring_setup().  To
+   queue a request it fills in sqes[sq_tail % URING_ENTRIES] and
+   increments sq_tail; uring_enter() then hands up to TO_SUBMIT
+   queued requests to kernel worker threads in one trap, advancing
+   sq_head past them.  Requests from one ring run in submission
+   order.  When a request finishes the kernel writes its result to
+   cqes[cq_tail % URING_ENTRIES] and increments cq_tail; the
+   process consumes completions by advancing cq_head. */
+
+#include <stdint.h>
+
+/* Number of slots in each queue. */
+#define URING_ENTRIES 32
+
+/* Maximum number of bytes moved by one read or write request.
+   Longer requests complete with a short count. */
+#define URING_MAX_LEN 4096
+
+/* Request types. */
+enum uring_op
+  {
+    URING_OP_NOP,               /* Do nothing; completes with 0. */
+    URING_OP_READ,              /* read (fd, buf, len); not from the
+                                   console, which completes with -1. */
+    URING_OP_WRITE,             /* write (fd, buf, len). */
+    URING_OP_OPEN,              /* open (buf); completes with the fd. */
+    URING_OP_CLOSE              /* close (fd); completes with 0 or -1. */
+  };
+
+/* Submission queue entry. */
+struct uring_sqe
+  {
+    int opcode;                 /* One of enum uring_op. */
+    int fd;                     /* File descriptor. */
+    void *buf;                  /* Data buffer, or file name for open. */
+    unsigned len;               /* Size of buffer in bytes. */
+    uint32_t user_data;         /* Copied to the completion. */
+  };
+
+/* Completion queue entry. */
+struct uring_cqe
+  {
+    uint32_t user_data;         /* From the submission. */
+    int res;                    /* System call's return value. */
+  };
+
+struct uring
+  {
+    unsigned sq_head;           /* Next entry to submit.  Kernel-owned. */
+    unsigned sq_tail;           /* Next free entry.  User-owned. */
+    unsigned cq_head;           /* Next completion to reap.  User-owned. */
+    unsigned cq_tail;           /* Next free completion.  Kernel-owned. */
+    struct uring_sqe sqes[URING_ENTRIES];
+    struct uring_cqe cqes[URING_ENTRIES];
+  };
+
+#endif /* lib/uring.h */
@@ -4,4 +4,41 @@
 int hprintf (int, const char *, ...) PRINTF_FORMAT (2, 3);
 int vhprintf (int, const char *, va_list) PRINTF_FORMAT (2, 0);
 
+/* Buffered streams. */
+typedef struct stream FILE;
+
+/* Buffering modes for setvbuf(). */
+#define _IOFBF 0                /* Write when the buffer fills. */
+#define _IOLBF 1                /* Also write at each new-line. */
+#define _IONBF 2                /* Write immediately. */
+
+#define BUFSIZ 512              /* Default buffer size. */
+#define FOPEN_MAX 8             /* Maximum open streams, with stdin and stdout. */
+#define EOF (-1)                /* Returned at end of file or on error. */
+
+/* Standard input is fully buffered.  Standard output is line
+   buffered, so that output is not lost if the process is
+   killed, and is flushed before standard input is read. */
+extern FILE *stdin;
+extern FILE *stdout;
+
+FILE *fdopen (int handle, const char *mode);
+int fclose (FILE *);
+int fflush (FILE *);
+int setvbuf (FILE *, char *buf, int mode, size_t size);
+int fileno (FILE *);
+int feof (FILE *);
+int ferror (FILE *);
+
+int fputc (int, FILE *);
+int fputs (const char *, FILE *);
+size_t fwrite (const void *, size_t size, size_t cnt, FILE *);
+int fprintf (FILE *, const char *, ...) PRINTF_FORMAT (2, 3);
+int vfprintf (FILE *, const char *, va_list) PRINTF_FORMAT (2, 0);
+
+int fgetc (FILE *);
+int getchar (void);
+char *fgets (char *, int size, FILE *);
+size_t fread (void *, size_t size, size_t cnt, FILE *);
+
 #endif /* lib/user/stdio.h */
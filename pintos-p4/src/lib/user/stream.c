@@ -0,0 +1,391 @@
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Buffered streams.
+
+   Each stream is opened either for reading or for writing and
+   owns a BUFSIZ buffer.  Output accumulates in the buffer and is
+   written with a single write() when the buffer fills, at each
+   new-line for line-buffered streams, on fflush(), and when the
+   process exits.  Input is read a buffer at a time and handed
+   out from the buffer.  There is no heap in user programs, so
+   the streams and their buffers are preallocated. */
+
+struct stream
+  {
+    int handle;                 /* File handle, or -1 if not open. */
+    bool writing;               /* Open for writing, not reading? */
+    int mode;                   /* _IOFBF, _IOLBF, or _IONBF. */
+    char *buf;                  /* Buffer. */
+    size_t size;                /* Size of buffer. */
+    size_t pos;                 /* Bytes buffered, or next byte to read. */
+    size_t len;                 /* Bytes in buffer, when reading. */
+    bool eof;                   /* End of file seen? */
+    bool error;                 /* Read or write failed? */
+  };
+
+static char buffers[FOPEN_MAX][BUFSIZ];
+static struct stream streams[FOPEN_MAX] =
+  {
+    {STDIN_FILENO, false, _IOFBF, buffers[0], BUFSIZ, 0, 0, false, false},
+    {STDOUT_FILENO, true, _IOLBF, buffers[1], BUFSIZ, 0, 0, false, false},
+    [2 ... FOPEN_MAX - 1] = {-1, false, _IOFBF, NULL, 0, 0, 0, false, false},
+  };
+
+FILE *stdin = &streams[0];
+FILE *stdout = &streams[1];
+
+static bool write_all (FILE *, const char *, size_t);
+static bool fill (FILE *);
+
+/* Opens a stream on HANDLE, which must already be open.  MODE
+   starts with 'r' for reading or 'w' or 'a' for writing.
+   Returns a null pointer if MODE is invalid or FOPEN_MAX streams
+   are already open. */
+FILE *
+fdopen (int handle, const char *mode) 
+{
+  int i;
+
+  if (handle < 0 || (mode[0] != 'r' && mode[0] != 'w' && mode[0] != 'a'))
+    return NULL;
+  for (i = 0; i < FOPEN_MAX; i++)
+    {
+      FILE *s = &streams[i];
+      if (s->handle < 0) 
+        {
+          s->handle = handle;
+          s->writing = mode[0] != 'r';
+          s->mode = _IOFBF;
+          s->buf = buffers[i];
+          s->size = BUFSIZ;
+          s->pos = s->len = 0;
+          s->eof = s->error = false;
+          return s;
+        }
+    }
+  return NULL;
+}
+
+/* Flushes and closes stream S and the handle beneath it.
+   Returns 0 if successful, EOF if buffered output could not be
+   written. */
+int
+fclose (FILE *s) 
+{
+  int retval = fflush (s);
+  close (s->handle);
+  s->handle = -1;
+  return retval;
+}
+
+/* Writes out the buffered output of stream S, or of every open
+   stream if S is a null pointer.  Returns 0 if successful, EOF
+   on a write error. */
+int
+fflush (FILE *s) 
+{
+  int retval = 0;
+
+  if (s == NULL) 
+    {
+      int i;
+      for (i = 0; i < FOPEN_MAX; i++)
+        if (streams[i].handle >= 0 && fflush (&streams[i]) != 0)
+          retval = EOF;
+      return retval;
+    }
+
+  if (s->writing && s->pos > 0) 
+    {
+      if (!write_all (s, s->buf, s->pos))
+        retval = EOF;
+      s->pos = 0;
+    }
+  return retval;
+}
+
+/* Sets the buffering MODE of stream S and, if BUF is nonnull,
+   makes the SIZE bytes at BUF its buffer.  Must be called before
+   any I/O on S.  Returns 0 if successful, nonzero if MODE is
+   invalid. */
+int
+setvbuf (FILE *s, char *buf, int mode, size_t size) 
+{
+  if (mode != _IOFBF && mode != _IOLBF && mode != _IONBF)
+    return -1;
+  s->mode = mode;
+  if (buf != NULL && size > 0) 
+    {
+      s->buf = buf;
+      s->size = size;
+    }
+  return 0;
+}
+
+/* Returns the handle beneath stream S. */
+int
+fileno (FILE *s) 
+{
+  return s->handle;
+}
+
+/* Returns true if a read from S has reached end of file. */
+int
+feof (FILE *s) 
+{
+  return s->eof;
+}
+
+/* Returns true if a read or write on S has failed. */
+int
+ferror (FILE *s) 
+{
+  return s->error;
+}
+
+/* Writes character C to stream S.  Returns C if successful, EOF
+   on error. */
+int
+fputc (int c, FILE *s) 
+{
+  char ch = c;
+
+  if (s->writing && s->mode != _IONBF && s->pos < s->size) 
+    {
+      s->buf[s->pos++] = ch;
+      if (s->pos >= s->size || (ch == '\n' && s->mode == _IOLBF))
+        if (fflush (s) != 0)
+          return EOF;
+      return (unsigned char) ch;
+    }
+  return fwrite (&ch, 1, 1, s) == 1 ? (unsigned char) ch : EOF;
+}
+
+/* Writes string S to stream STREAM, without a new-line.  Returns
+   0 if successful, EOF on error. */
+int
+fputs (const char *s, FILE *stream) 
+{
+  size_t length = strlen (s);
+  return fwrite (s, 1, length, stream) == length ? 0 : EOF;
+}
+
+/* Writes CNT elements of SIZE bytes each from BUFFER to stream S.
+   Returns the number of elements written, which is less than CNT
+   only on error. */
+size_t
+fwrite (const void *buffer, size_t size, size_t cnt, FILE *s) 
+{
+  const char *p = buffer;
+  size_t left = size * cnt;
+
+  if (!s->writing || left == 0)
+    return s->writing ? cnt : 0;
+
+  if (s->mode == _IONBF)
+    return write_all (s, p, left) ? cnt : 0;
+
+  while (left > 0) 
+    {
+      size_t chunk;
+
+      /* Skip the copy for writes too big to buffer. */
+      if (s->pos == 0 && left >= s->size)
+        {
+          if (!write_all (s, p, left))
+            return 0;
+          break;
+        }
+
+      chunk = s->size - s->pos;
+      if (chunk > left)
+        chunk = left;
+      memcpy (s->buf + s->pos, p, chunk);
+      s->pos += chunk;
+      p += chunk;
+      left -= chunk;
+      if (s->pos >= s->size && fflush (s) != 0)
+        return 0;
+    }
+
+  if (s->mode == _IOLBF && memchr (buffer, '\n', size * cnt) != NULL
+      && fflush (s) != 0)
+    return 0;
+  return cnt;
+}
+
+/* Like printf(), but writes output to stream S. */
+int
+fprintf (FILE *s, const char *format, ...) 
+{
+  va_list args;
+  int retval;
+
+  va_start (args, format);
+  retval = vfprintf (s, format, args);
+  va_end (args);
+
+  return retval;
+}
+
+/* Auxiliary data for vfprintf_helper(). */
+struct vfprintf_aux 
+  {
+    FILE *stream;       /* Output stream. */
+    int char_cnt;       /* Total characters written so far. */
+  };
+
+/* Writes C to the stream in AUX. */
+static void
+vfprintf_helper (char c, void *aux_) 
+{
+  struct vfprintf_aux *aux = aux_;
+  fputc (c, aux->stream);
+  aux->char_cnt++;
+}
+
+/* Like vprintf(), but writes output to stream S. */
+int
+vfprintf (FILE *s, const char *format, va_list args) 
+{
+  struct vfprintf_aux aux;
+  aux.stream = s;
+  aux.char_cnt = 0;
+  __vprintf (format, args, vfprintf_helper, &aux);
+  return aux.char_cnt;
+}
+
+/* Reads and returns the next character from stream S, or EOF at
+   end of file or on error. */
+int
+fgetc (FILE *s) 
+{
+  if (s->pos >= s->len && !fill (s))
+    return EOF;
+  return (unsigned char) s->buf[s->pos++];
+}
+
+/* Reads and returns the next character from standard input. */
+int
+getchar (void) 
+{
+  return fgetc (stdin);
+}
+
+/* Reads characters from stream S into BUFFER until a new-line,
+   which is stored, or until SIZE - 1 characters have been read.
+   Null-terminates BUFFER.  Returns BUFFER, or a null pointer if
+   no characters could be read. */
+char *
+fgets (char *buffer, int size, FILE *s) 
+{
+  char *p = buffer;
+
+  if (size <= 0)
+    return NULL;
+  while (p < buffer + size - 1) 
+    {
+      int c = fgetc (s);
+      if (c == EOF)
+        break;
+      *p++ = c;
+      if (c == '\n')
+        break;
+    }
+  if (p == buffer)
+    return NULL;
+  *p = '\0';
+  return buffer;
+}
+
+/* Reads up to CNT elements of SIZE bytes each from stream S into
+   BUFFER.  Returns the number of whole elements read. */
+size_t
+fread (void *buffer, size_t size, size_t cnt, FILE *s) 
+{
+  char *p = buffer;
+  size_t left = size * cnt;
+
+  if (size == 0)
+    return 0;
+  while (left > 0) 
+    {
+      size_t chunk;
+
+      if (s->pos >= s->len) 
+        {
+          /* Read big requests straight into BUFFER. */
+          if (left >= s->size && !s->eof && !s->error) 
+            {
+              int n = read (s->handle, p, left);
+              if (n <= 0) 
+                {
+                  s->eof = n == 0;
+                  s->error = n < 0;
+                  break;
+                }
+              p += n;
+              left -= n;
+              continue;
+            }
+          if (!fill (s))
+            break;
+        }
+
+      chunk = s->len - s->pos;
+      if (chunk > left)
+        chunk = left;
+      memcpy (p, s->buf + s->pos, chunk);
+      s->pos += chunk;
+      p += chunk;
+      left -= chunk;
+    }
+  return (p - (char *) buffer) / size;
+}
+
+/* Writes the SIZE bytes at BUFFER to S's handle, retrying short
+   writes.  Returns true if successful. */
+static bool
+write_all (FILE *s, const char *buffer, size_t size) 
+{
+  while (size > 0) 
+    {
+      int n = write (s->handle, buffer, size);
+      if (n <= 0) 
+        {
+          s->error = true;
+          return false;
+        }
+      buffer += n;
+      size -= n;
+    }
+  return true;
+}
+
+/* Refills read stream S's buffer.  Returns false at end of file
+   or on error. */
+static bool
+fill (FILE *s) 
+{
+  int n;
+
+  if (s->writing || s->eof || s->error)
+    return false;
+
+  /* Make sure any prompt is visible before waiting for input. */
+  if (s == stdin)
+    fflush (stdout);
+
+  n = read (s->handle, s->buf, s->size);
+  s->pos = 0;
+  s->len = n > 0 ? n : 0;
+  if (n <= 0) 
+    {
+      s->eof = n == 0;
+      s->error = n < 0;
+      return false;
+    }
+  return true;
+}
@@ -3,6 +3,9 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <iovec.h>
+#include <uring.h>
+#include <spawn.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +48,17 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+int copy_file_range (int fd_in, int fd_out, unsigned length);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int uring_setup (struct uring *);
+int uring_enter (unsigned to_submit, unsigned min_complete);
+pid_t spawn (const char *file, char *const argv[],
+             const struct spawn_action *actions, int action_cnt);
+bool pipe (int fds[2]);
+pid_t wait_any (int *status);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,18 @@
+/* Child process run by spawn-redirect, pipe-child and wait-any.
+   Copies its stdin to its stdout and exits with its argument
+   count, printing nothing else. */
+
+#include <stdio.h>
+#include <syscall.h>
+
+int
+main (int argc, char *argv[] UNUSED) 
+{
+  char buf[64];
+  int n;
+
+  while ((n = read (STDIN_FILENO, buf, sizeof buf)) > 0)
+    if (write (STDOUT_FILENO, buf, n) != n)
+      return -1;
+  return argc;
+}
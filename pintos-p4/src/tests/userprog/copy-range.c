@@ -0,0 +1,32 @@
+/* Copies sample.txt into a new file with copy_file_range() and
+   verifies the copy, then checks that both file positions were
+   advanced past the copied data. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int in_fd, out_fd, byte_cnt;
+
+  CHECK ((in_fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (create ("copy.txt", 0), "create \"copy.txt\"");
+  CHECK ((out_fd = open ("copy.txt")) > 1, "open \"copy.txt\"");
+
+  byte_cnt = copy_file_range (in_fd, out_fd, sizeof sample - 1);
+  if (byte_cnt != sizeof sample - 1)
+    fail ("copy_file_range() returned %d instead of %zu",
+          byte_cnt, sizeof sample - 1);
+  if (tell (in_fd) != sizeof sample - 1 || tell (out_fd) != sizeof sample - 1)
+    fail ("copy_file_range() did not advance file positions");
+
+  byte_cnt = copy_file_range (in_fd, out_fd, sizeof sample - 1);
+  if (byte_cnt != 0)
+    fail ("copy_file_range() at end of file returned %d", byte_cnt);
+
+  close (out_fd);
+  check_file ("copy.txt", sample, sizeof sample - 1);
+}
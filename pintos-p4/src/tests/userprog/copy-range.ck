@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-range) begin
+(copy-range) open "sample.txt"
+(copy-range) create "copy.txt"
+(copy-range) open "copy.txt"
+(copy-range) open "copy.txt" for verification
+(copy-range) verified contents of "copy.txt"
+(copy-range) close "copy.txt"
+(copy-range) end
+copy-range: exit(0)
+EOF
+pass;
@@ -0,0 +1,44 @@
+/* Maps a file several pages long and copies it to another file
+   straight from the mapping, so that the kernel faults the pages
+   in while writing.  Then changes a byte on every page through the
+   mapping and checks, after munmap(), that the changes reached the
+   file and that the file did not grow. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (6 * 4096 - 100)
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  int handle;
+  mapid_t map;
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    buf[i] = 'a' + i % 26;
+  CHECK (create ("big.txt", 0), "create \"big.txt\"");
+  CHECK ((handle = open ("big.txt")) > 1, "open \"big.txt\"");
+  CHECK (write (handle, buf, SIZE) == SIZE, "write \"big.txt\"");
+  CHECK ((map = mmap (handle, actual)) != MAP_FAILED, "mmap \"big.txt\"");
+  close (handle);
+
+  CHECK (create ("copy.txt", 0), "create \"copy.txt\"");
+  CHECK ((handle = open ("copy.txt")) > 1, "open \"copy.txt\"");
+  CHECK (write (handle, actual, SIZE) == SIZE,
+         "write \"copy.txt\" from mapping");
+  close (handle);
+  check_file ("copy.txt", buf, SIZE);
+
+  for (i = 0; i < SIZE; i += 4096)
+    actual[i] = buf[i] = 'X';
+  actual[SIZE] = 'Y';
+  msg ("munmap \"big.txt\"");
+  munmap (map);
+  check_file ("big.txt", buf, SIZE);
+}
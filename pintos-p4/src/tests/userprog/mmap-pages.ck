@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mmap-pages) begin
+(mmap-pages) create "big.txt"
+(mmap-pages) open "big.txt"
+(mmap-pages) write "big.txt"
+(mmap-pages) mmap "big.txt"
+(mmap-pages) create "copy.txt"
+(mmap-pages) open "copy.txt"
+(mmap-pages) write "copy.txt" from mapping
+(mmap-pages) open "copy.txt" for verification
+(mmap-pages) verified contents of "copy.txt"
+(mmap-pages) close "copy.txt"
+(mmap-pages) munmap "big.txt"
+(mmap-pages) open "big.txt" for verification
+(mmap-pages) verified contents of "big.txt"
+(mmap-pages) close "big.txt"
+(mmap-pages) end
+mmap-pages: exit(0)
+EOF
+pass;
@@ -0,0 +1,23 @@
+/* Opens a file several times, closes one of the handles, and
+   verifies that the next open() reuses the lowest free fd. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int h1, h2, h3, h4;
+
+  CHECK ((h1 = open ("sample.txt")) > 1, "open \"sample.txt\" once");
+  CHECK ((h2 = open ("sample.txt")) > 1, "open \"sample.txt\" again");
+  CHECK ((h3 = open ("sample.txt")) > 1, "open \"sample.txt\" a third time");
+  msg ("close the second handle");
+  close (h2);
+  CHECK ((h4 = open ("sample.txt")) > 1, "open \"sample.txt\" a fourth time");
+  if (h4 != h2)
+    fail ("fd %d was not reused (got %d)", h2, h4);
+  if (h4 == h1 || h4 == h3)
+    fail ("open returned fd %d, which is still in use", h4);
+}
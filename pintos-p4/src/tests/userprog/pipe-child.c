@@ -0,0 +1,64 @@
+/* Connects child-cat to the parent with two pipes, sends it three
+   pages through one and reads them back through the other into a
+   page-aligned buffer.  Also checks end of file once the child
+   exits and that writing to a pipe with no reader fails. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define DATA_SIZE (3 * 4096)
+
+static char data[DATA_SIZE];
+static char buffer[DATA_SIZE] __attribute__ ((aligned (4096)));
+
+void
+test_main (void) 
+{
+  char *argv[] = {"child-cat", NULL};
+  struct spawn_action actions[2];
+  int in[2], out[2], broken[2];
+  size_t ofs;
+  pid_t pid;
+  int n;
+
+  for (ofs = 0; ofs < sizeof data; ofs++)
+    data[ofs] = ofs * 7 + ofs / 4096;
+
+  CHECK (pipe (in), "pipe");
+  CHECK (pipe (out), "pipe");
+
+  actions[0].op = SPAWN_DUP2;
+  actions[0].fd = STDIN_FILENO;
+  actions[0].src_fd = in[0];
+  actions[1].op = SPAWN_DUP2;
+  actions[1].fd = STDOUT_FILENO;
+  actions[1].src_fd = out[1];
+  CHECK ((pid = spawn ("child-cat", argv, actions, 2)) != PID_ERROR,
+         "spawn \"child-cat\"");
+  close (in[0]);
+  close (out[1]);
+
+  /* Three pages fit in the pipe, so the child finishes copying
+     them without the parent reading anything. */
+  CHECK (write (in[1], data, sizeof data) == (int) sizeof data,
+         "write %d bytes to pipe", DATA_SIZE);
+  close (in[1]);
+  msg ("wait(spawn()) = %d", wait (pid));
+
+  ofs = 0;
+  while ((n = read (out[0], buffer + ofs, sizeof buffer - ofs)) > 0)
+    ofs += n;
+  if (ofs != sizeof data)
+    fail ("read %zu bytes back instead of %d", ofs, DATA_SIZE);
+  compare_bytes (buffer, data, sizeof data, 0, "pipe");
+  msg ("read data back from pipe");
+  CHECK (read (out[0], buffer, 1) == 0, "read end of file");
+  close (out[0]);
+
+  CHECK (pipe (broken), "pipe");
+  close (broken[0]);
+  CHECK (write (broken[1], data, 1) == -1, "write to pipe with no reader");
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-child) begin
+(pipe-child) pipe
+(pipe-child) pipe
+(pipe-child) spawn "child-cat"
+(pipe-child) write 12288 bytes to pipe
+child-cat: exit(1)
+(pipe-child) wait(spawn()) = 1
+(pipe-child) read data back from pipe
+(pipe-child) read end of file
+(pipe-child) pipe
+(pipe-child) write to pipe with no reader
+(pipe-child) end
+pipe-child: exit(0)
+EOF
+pass;
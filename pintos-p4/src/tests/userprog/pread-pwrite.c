@@ -0,0 +1,35 @@
+/* Reads and writes sample.txt at explicit offsets with pread()
+   and pwrite() and checks that the fd's position is untouched. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buffer[64];
+  int handle, byte_cnt;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  seek (handle, 10);
+
+  byte_cnt = pread (handle, buffer, sizeof buffer, 100);
+  if (byte_cnt != sizeof buffer)
+    fail ("pread() returned %d instead of %zu", byte_cnt, sizeof buffer);
+  compare_bytes (buffer, sample + 100, sizeof buffer, 100, "sample.txt");
+
+  memset (buffer, 'x', sizeof buffer);
+  byte_cnt = pwrite (handle, buffer, sizeof buffer, 150);
+  if (byte_cnt != sizeof buffer)
+    fail ("pwrite() returned %d instead of %zu", byte_cnt, sizeof buffer);
+  memset (sample + 150, 'x', sizeof buffer);
+
+  if (tell (handle) != 10)
+    fail ("file position moved to %u", tell (handle));
+  close (handle);
+
+  check_file ("sample.txt", sample, sizeof sample - 1);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) open "sample.txt"
+(pread-pwrite) open "sample.txt" for verification
+(pread-pwrite) verified contents of "sample.txt"
+(pread-pwrite) close "sample.txt"
+(pread-pwrite) end
+pread-pwrite: exit(0)
+EOF
+pass;
@@ -0,0 +1,41 @@
+/* Writes sample.txt into a new file from three buffers with
+   writev(), then reads it back into three buffers with readv(). */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buffer[sizeof sample];
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  struct iovec iov[3];
+  int handle, byte_cnt;
+
+  CHECK (create ("test.txt", 0), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  iov[0].iov_base = sample;
+  iov[0].iov_len = 17;
+  iov[1].iov_base = sample + 17;
+  iov[1].iov_len = 100;
+  iov[2].iov_base = sample + 117;
+  iov[2].iov_len = size - 117;
+  byte_cnt = writev (handle, iov, 3);
+  if (byte_cnt != (int) size)
+    fail ("writev() returned %d instead of %zu", byte_cnt, size);
+
+  seek (handle, 0);
+  iov[0].iov_base = buffer;
+  iov[1].iov_base = buffer + 17;
+  iov[2].iov_base = buffer + 117;
+  byte_cnt = readv (handle, iov, 3);
+  if (byte_cnt != (int) size)
+    fail ("readv() returned %d instead of %zu", byte_cnt, size);
+  compare_bytes (buffer, sample, size, 0, "test.txt");
+
+  close (handle);
+}
@@ -0,0 +1,32 @@
+/* Starts child-cat with spawn(), with its stdin redirected from
+   sample.txt and its stdout to a new file, and verifies that the
+   file ends up holding a copy of sample.txt.  Also checks that the
+   child sees the argument list it was given. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char *argv[] = {"child-cat", "one", "two", NULL};
+  struct spawn_action actions[2];
+  pid_t pid;
+
+  CHECK (create ("out.txt", 0), "create \"out.txt\"");
+
+  actions[0].op = SPAWN_OPEN;
+  actions[0].fd = STDIN_FILENO;
+  actions[0].path = "sample.txt";
+  actions[1].op = SPAWN_OPEN;
+  actions[1].fd = STDOUT_FILENO;
+  actions[1].path = "out.txt";
+  CHECK ((pid = spawn ("child-cat", argv, actions, 2)) != PID_ERROR,
+         "spawn \"child-cat\"");
+  msg ("wait(spawn()) = %d", wait (pid));
+
+  check_file ("out.txt", sample, sizeof sample - 1);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-redirect) begin
+(spawn-redirect) create "out.txt"
+(spawn-redirect) spawn "child-cat"
+child-cat: exit(3)
+(spawn-redirect) wait(spawn()) = 3
+(spawn-redirect) open "out.txt" for verification
+(spawn-redirect) verified contents of "out.txt"
+(spawn-redirect) close "out.txt"
+(spawn-redirect) end
+spawn-redirect: exit(0)
+EOF
+pass;
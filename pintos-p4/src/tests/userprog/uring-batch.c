@@ -0,0 +1,66 @@
+/* Opens, reads and closes sample.txt through a submission ring,
+   submitting two requests per uring_enter() call. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct uring ring;
+static char buffer[sizeof sample];
+
+/* Queues a request on the ring. */
+static void
+queue (int opcode, int fd, void *buf, unsigned len, uint32_t user_data)
+{
+  struct uring_sqe *sqe = &ring.sqes[ring.sq_tail % URING_ENTRIES];
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->buf = buf;
+  sqe->len = len;
+  sqe->user_data = user_data;
+  ring.sq_tail++;
+}
+
+/* Reaps the next completion, which must be for USER_DATA, and
+   returns its result. */
+static int
+reap (uint32_t user_data)
+{
+  struct uring_cqe *cqe;
+
+  if (ring.cq_head == ring.cq_tail)
+    fail ("no completion for request %u", user_data);
+  cqe = &ring.cqes[ring.cq_head % URING_ENTRIES];
+  if (cqe->user_data != user_data)
+    fail ("completion for request %u instead of %u",
+          cqe->user_data, user_data);
+  ring.cq_head++;
+  return cqe->res;
+}
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  int handle, byte_cnt;
+
+  CHECK (uring_setup (&ring) == 0, "uring_setup");
+
+  queue (URING_OP_OPEN, 0, "sample.txt", 0, 1);
+  queue (URING_OP_NOP, 0, NULL, 0, 2);
+  CHECK (uring_enter (2, 2) == 2, "submit open and nop");
+  CHECK ((handle = reap (1)) > 1, "open \"sample.txt\"");
+  if (reap (2) != 0)
+    fail ("nop failed");
+
+  queue (URING_OP_READ, handle, buffer, size, 3);
+  queue (URING_OP_CLOSE, handle, NULL, 0, 4);
+  CHECK (uring_enter (2, 2) == 2, "submit read and close");
+  byte_cnt = reap (3);
+  if (byte_cnt != (int) size)
+    fail ("read returned %d instead of %zu", byte_cnt, size);
+  compare_bytes (buffer, sample, size, 0, "sample.txt");
+  if (reap (4) != 0)
+    fail ("close failed");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(uring-batch) begin
+(uring-batch) uring_setup
+(uring-batch) submit open and nop
+(uring-batch) open "sample.txt"
+(uring-batch) submit read and close
+(uring-batch) end
+uring-batch: exit(0)
+EOF
+pass;
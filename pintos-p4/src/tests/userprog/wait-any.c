@@ -0,0 +1,54 @@
+/* Starts two children that block reading their own pipes, then
+   lets them exit one at a time and checks that wait_any() reaps
+   each as it exits, with the right status.  Reaped children can no
+   longer be waited for, and wait_any() fails once none are left. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Starts child-cat with ARGV, reading from a new pipe whose write
+   end is stored in *WRITE_FD. */
+static pid_t
+start_child (char *argv[], int *write_fd)
+{
+  struct spawn_action action;
+  int fds[2];
+  pid_t pid;
+
+  CHECK (pipe (fds), "pipe");
+  action.op = SPAWN_DUP2;
+  action.fd = STDIN_FILENO;
+  action.src_fd = fds[0];
+  CHECK ((pid = spawn ("child-cat", argv, &action, 1)) != PID_ERROR,
+         "spawn \"child-cat\"");
+  close (fds[0]);
+  *write_fd = fds[1];
+  return pid;
+}
+
+void
+test_main (void) 
+{
+  char *argv_a[] = {"child-cat", "a", NULL};
+  char *argv_b[] = {"child-cat", "b", "b", NULL};
+  int write_a, write_b, status;
+  pid_t a, b, pid;
+
+  a = start_child (argv_a, &write_a);
+  b = start_child (argv_b, &write_b);
+
+  close (write_b);
+  pid = wait_any (&status);
+  msg ("wait_any() = %s, status %d",
+       pid == a ? "a" : pid == b ? "b" : "?", status);
+
+  close (write_a);
+  pid = wait_any (&status);
+  msg ("wait_any() = %s, status %d",
+       pid == a ? "a" : pid == b ? "b" : "?", status);
+
+  CHECK (wait (a) == -1, "wait for reaped child");
+  CHECK (wait_any (&status) == PID_ERROR, "wait_any() with no children");
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(wait-any) begin
+(wait-any) pipe
+(wait-any) spawn "child-cat"
+(wait-any) pipe
+(wait-any) spawn "child-cat"
+child-cat: exit(3)
+(wait-any) wait_any() = b, status 3
+child-cat: exit(2)
+(wait-any) wait_any() = a, status 2
+(wait-any) wait for reaped child
+(wait-any) wait_any() with no children
+(wait-any) end
+wait-any: exit(0)
+EOF
+pass;
@@ -25,6 +25,7 @@
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
+#include "userprog/exec-cache.h"
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
@@ -113,6 +114,8 @@ main (void)
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  exec_cache_init ();
+  process_init ();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
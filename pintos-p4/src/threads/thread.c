@@ -1,5 +1,4 @@
 #include "threads/thread.h"
-#include "threads/malloc.h"
 #include <debug.h>
 #include <stddef.h>
 #include <random.h>
@@ -199,22 +198,8 @@ thread_create (const char *name, int priority,
   sf->eip = switch_entry;
   sf->ebp = 0;
 
-  // add this thread to kernel thread's children list
-  struct thread *kernel_t = thread_current();
-  t->wd = kernel_t->wd;
-  t->parent = kernel_t->tid;
-  struct child_wrapper *childwp = malloc(sizeof(struct child_wrapper));
-  childwp->realchild = t;
-  childwp->tid = tid;
-  childwp->exit_flag = t->exit_flag;
-  childwp->exitstatus = t->exitstatus;
-  childwp->waitedfor = t->waitedfor;
-  childwp->loaded = t->loaded;
-  kernel_t->cur_child = childwp;
-  t->wrapper = childwp;
-  enum intr_level old_level = intr_disable ();
-  list_push_back (&kernel_t->children, &childwp->child_elem);
-  intr_set_level (old_level);
+  /* Inherit the working directory. */
+  t->wd = thread_current ()->wd;
 
 
   /* Add to run queue. */
@@ -484,15 +469,14 @@ init_thread (struct thread *t, const char *name, int priority)
   t->magic = THREAD_MAGIC;
 
   list_init (&t->children);
-  t->waitedfor = 0;
-  sema_init(&t->exit_semaphore, 0);
-  sema_init(&t->init_semaphore, 0);
-  sema_init(&t->load_semaphore, 0);
-  t->loaded = 0;
-  t->cur_child = NULL;
-  list_init (&t->file_list);
-  t->fd = 2;
-  t->exit_flag = 0;
+  list_init (&t->exited_children);
+  cond_init (&t->child_exited);
+  t->fd_table = NULL;
+  t->fd_table_size = 0;
+  t->fd_map = NULL;
+  t->uring = NULL;
+  list_init (&t->mappings);
+  t->next_mapid = 0;
   t->wrapper = NULL;
   t->exitstatus = -1;
   t->wd = 1;
@@ -7,6 +7,11 @@
 #include "threads/synch.h"
 #include "devices/block.h"
 
+struct file_in_thread;
+struct child_wrapper;
+struct bitmap;
+struct uring_ctx;
+
 /* States in a thread's life cycle. */
 enum thread_status
   {
@@ -95,19 +100,17 @@ struct thread
     int exitstatus;
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
-    tid_t parent;
-    struct list children;
-    struct child_wrapper *cur_child; // child most recently added
-    struct child_wrapper *wrapper;
-    int waitedfor;
-    struct semaphore exit_semaphore;
-    struct semaphore init_semaphore;
-    struct semaphore load_semaphore;
-    int loaded; // 0 = not loaded, -1 = fail, 1 = loaded
-    int fd;
+    struct list children;               /* Running children's wrappers. */
+    struct list exited_children;        /* Exited, unreaped children's. */
+    struct condition child_exited;      /* Signaled when a child exits. */
+    struct child_wrapper *wrapper;      /* Our own, if a user process. */
     block_sector_t wd;
-    struct list file_list;
-    int exit_flag;
+    struct file_in_thread **fd_table;   /* Open files, indexed by fd. */
+    size_t fd_table_size;               /* Number of slots in fd_table. */
+    struct bitmap *fd_map;              /* In-use fds in fd_table. */
+    struct uring_ctx *uring;            /* Registered syscall ring, if any. */
+    struct list mappings;               /* Memory-mapped files. */
+    int next_mapid;                     /* Identifier for next mapping. */
 
 
 
@@ -122,16 +125,6 @@ struct thread
 
   };
 
-struct child_wrapper {
-  struct thread* realchild;
-  int tid;
-  int exit_flag;
-  int exitstatus;
-  int waitedfor;
-  int loaded;
-  struct list_elem child_elem;
-};
-
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
@@ -2,8 +2,11 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/uaccess.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/mmap.h"
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -152,6 +155,17 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+  /* Pages of memory-mapped files are read in on first touch,
+     whether by the process or by the kernel on its behalf. */
+  if (not_present && is_user_vaddr (fault_addr) && mmap_fault (fault_addr))
+    return;
+
+  /* A kernel fault on one of the user memory accessors in
+     userprog/uaccess.c means the user passed a bad pointer.
+     Resume at the accessor's fixup, which reports the error. */
+  if (!user && uaccess_fixup (f))
+    return;
+
   /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
      which fault_addr refers. */
@@ -0,0 +1,280 @@
+#include "userprog/exec-cache.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Cache of parsed executables.
+
+   Running the same program over and over (the shell's commands,
+   or a test's children) used to repeat the same work on every
+   exec: read and check the ELF header, read and check each
+   program header, and read every page of every segment from
+   disk.  The cache keeps the parsed result for the most recently
+   used executables, keyed by inode, along with a copy of the
+   pages of their read-only segments, so that a repeat exec only
+   has to copy those pages and read the writable ones.
+
+   Each cached image keeps its inode open, which lets a write to
+   the executable be detected through inode_write_cnt() (a stale
+   image is dropped at the next lookup) but also keeps a removed
+   executable's blocks allocated until its image is evicted. */
+
+/* Maximum number of images in the cache. */
+#define EXEC_CACHE_SIZE 8
+
+/* Maximum number of kernel pages used for cached page contents. */
+#define EXEC_CACHE_PAGES 64
+
+/* Cached images, most recently used first. */
+static struct list images;
+static size_t image_cnt;
+
+/* Number of pages of segment contents currently cached. */
+static size_t page_cnt;
+
+/* Protects all of the above and the page arrays of cached
+   images. */
+static struct lock cache_lock;
+
+static void uncache (struct exec_image *);
+
+/* Initializes the executable cache. */
+void
+exec_cache_init (void) 
+{
+  list_init (&images);
+  lock_init (&cache_lock);
+}
+
+/* Creates and returns a new image with no segments for the
+   executable in INODE, with a single reference held by the
+   caller.  Returns a null pointer if memory is exhausted. */
+struct exec_image *
+exec_image_create (struct inode *inode) 
+{
+  struct exec_image *img = malloc (sizeof *img);
+  if (img == NULL)
+    return NULL;
+  img->inode = inode_reopen (inode);
+  img->write_cnt = inode_write_cnt (inode);
+  img->entry = NULL;
+  img->segments = NULL;
+  img->segment_cnt = 0;
+  img->ref_cnt = 1;
+  img->cached = false;
+  return img;
+}
+
+/* Appends a copy of SEG to IMG's segments.  Returns false if
+   memory is exhausted. */
+bool
+exec_image_add_segment (struct exec_image *img,
+                        const struct exec_segment *seg) 
+{
+  struct exec_segment *segments;
+  struct exec_segment *new_seg;
+
+  segments = realloc (img->segments,
+                      (img->segment_cnt + 1) * sizeof *segments);
+  if (segments == NULL)
+    return false;
+  img->segments = segments;
+
+  new_seg = &segments[img->segment_cnt];
+  *new_seg = *seg;
+  new_seg->pages = NULL;
+  if (!seg->writable) 
+    {
+      size_t pages = (seg->read_bytes + seg->zero_bytes) / PGSIZE;
+      new_seg->pages = calloc (pages, sizeof *new_seg->pages);
+      if (new_seg->pages == NULL)
+        return false;
+    }
+  img->segment_cnt++;
+  return true;
+}
+
+/* Drops a reference to IMG, freeing it and its cached pages when
+   the last reference goes away. */
+void
+exec_image_release (struct exec_image *img) 
+{
+  size_t i;
+
+  if (img == NULL)
+    return;
+
+  lock_acquire (&cache_lock);
+  if (--img->ref_cnt > 0) 
+    {
+      lock_release (&cache_lock);
+      return;
+    }
+  for (i = 0; i < img->segment_cnt; i++) 
+    {
+      struct exec_segment *seg = &img->segments[i];
+      if (seg->pages != NULL) 
+        {
+          size_t pages = (seg->read_bytes + seg->zero_bytes) / PGSIZE;
+          size_t j;
+          for (j = 0; j < pages; j++)
+            if (seg->pages[j] != NULL) 
+              {
+                palloc_free_page (seg->pages[j]);
+                page_cnt--;
+              }
+          free (seg->pages);
+        }
+    }
+  lock_release (&cache_lock);
+
+  lock_acquire (&file_lock);
+  inode_close (img->inode);
+  lock_release (&file_lock);
+  free (img->segments);
+  free (img);
+}
+
+/* Fills KPAGE with page PAGE_IDX of segment SEG of IMG: the
+   segment's file bytes for that page, read from FILE, followed
+   by zeros.  Read-only pages of cached images come from the
+   cache when possible, and are added to it after a disk read
+   when there is room.  Returns false on a short read. */
+bool
+exec_image_read_page (struct exec_image *img, struct exec_segment *seg,
+                      size_t page_idx, struct file *file, uint8_t *kpage) 
+{
+  size_t ofs = page_idx * PGSIZE;
+  size_t page_read_bytes = 0;
+
+  if (ofs < seg->read_bytes)
+    page_read_bytes = seg->read_bytes - ofs < PGSIZE
+                      ? seg->read_bytes - ofs : PGSIZE;
+
+  if (seg->pages != NULL) 
+    {
+      lock_acquire (&cache_lock);
+      if (seg->pages[page_idx] != NULL) 
+        {
+          memcpy (kpage, seg->pages[page_idx], PGSIZE);
+          lock_release (&cache_lock);
+          return true;
+        }
+      lock_release (&cache_lock);
+    }
+
+  if (file_read_at (file, kpage, page_read_bytes, seg->file_page + ofs)
+      != (off_t) page_read_bytes)
+    return false;
+  memset (kpage + page_read_bytes, 0, PGSIZE - page_read_bytes);
+
+  if (seg->pages != NULL) 
+    {
+      lock_acquire (&cache_lock);
+      if (img->cached && seg->pages[page_idx] == NULL
+          && page_cnt < EXEC_CACHE_PAGES) 
+        {
+          uint8_t *copy = palloc_get_page (0);
+          if (copy != NULL) 
+            {
+              memcpy (copy, kpage, PGSIZE);
+              seg->pages[page_idx] = copy;
+              page_cnt++;
+            }
+        }
+      lock_release (&cache_lock);
+    }
+  return true;
+}
+
+/* Looks up INODE in the cache.  If it is there and the
+   executable has not been written since it was parsed, returns
+   its image with a new reference for the caller; otherwise
+   returns a null pointer. */
+struct exec_image *
+exec_cache_lookup (struct inode *inode) 
+{
+  struct exec_image *stale = NULL;
+  struct list_elem *e;
+
+  lock_acquire (&cache_lock);
+  for (e = list_begin (&images); e != list_end (&images); e = list_next (e)) 
+    {
+      struct exec_image *img = list_entry (e, struct exec_image, elem);
+      if (img->inode == inode) 
+        {
+          if (img->write_cnt == inode_write_cnt (inode)) 
+            {
+              list_remove (&img->elem);
+              list_push_front (&images, &img->elem);
+              img->ref_cnt++;
+              lock_release (&cache_lock);
+              return img;
+            }
+          uncache (img);
+          stale = img;
+          break;
+        }
+    }
+  lock_release (&cache_lock);
+
+  exec_image_release (stale);
+  return NULL;
+}
+
+/* Adds IMG, which must not already be cached, to the cache,
+   evicting the least recently used image if the cache is full
+   and dropping images of executables that have been removed. */
+void
+exec_cache_insert (struct exec_image *img) 
+{
+  struct exec_image *victims[EXEC_CACHE_SIZE + 1];
+  size_t victim_cnt = 0;
+  struct list_elem *e, *next;
+  size_t i;
+
+  lock_acquire (&cache_lock);
+  ASSERT (!img->cached);
+  for (e = list_begin (&images); e != list_end (&images); e = next) 
+    {
+      struct exec_image *old = list_entry (e, struct exec_image, elem);
+      next = list_next (e);
+      if (inode_is_removed (old->inode)) 
+        {
+          uncache (old);
+          victims[victim_cnt++] = old;
+        }
+    }
+  if (image_cnt >= EXEC_CACHE_SIZE) 
+    {
+      struct exec_image *old = list_entry (list_back (&images),
+                                           struct exec_image, elem);
+      uncache (old);
+      victims[victim_cnt++] = old;
+    }
+  list_push_front (&images, &img->elem);
+  img->cached = true;
+  img->ref_cnt++;
+  image_cnt++;
+  lock_release (&cache_lock);
+
+  for (i = 0; i < victim_cnt; i++)
+    exec_image_release (victims[i]);
+}
+
+/* Removes IMG from the cache.  The cache's reference becomes the
+   caller's to release, after dropping cache_lock. */
+static void
+uncache (struct exec_image *img) 
+{
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+  ASSERT (img->cached);
+  list_remove (&img->elem);
+  img->cached = false;
+  image_cnt--;
+}
@@ -0,0 +1,50 @@
+#ifndef USERPROG_EXEC_CACHE_H
+#define USERPROG_EXEC_CACHE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct file;
+struct inode;
+
+/* A loadable segment of an executable, rounded out to whole
+   pages. */
+struct exec_segment
+  {
+    uint32_t file_page;         /* File offset of the first page. */
+    uint8_t *mem_page;          /* User address of the first page. */
+    uint32_t read_bytes;        /* Bytes to read from the file. */
+    uint32_t zero_bytes;        /* Bytes to zero after them. */
+    bool writable;              /* Map the pages writable? */
+    uint8_t **pages;            /* Cached page contents, if read-only. */
+  };
+
+/* An executable as described by its ELF headers: everything
+   load() needs to build a process image except the page
+   contents, some of which may be cached as well. */
+struct exec_image
+  {
+    struct inode *inode;        /* The executable. */
+    unsigned write_cnt;         /* inode_write_cnt() when parsed. */
+    void (*entry) (void);       /* Entry point. */
+    struct exec_segment *segments; /* Loadable segments. */
+    size_t segment_cnt;         /* Number of segments. */
+    int ref_cnt;                /* References, including the cache's. */
+    bool cached;                /* In the cache? */
+    struct list_elem elem;      /* Element in the cache. */
+  };
+
+void exec_cache_init (void);
+struct exec_image *exec_image_create (struct inode *);
+bool exec_image_add_segment (struct exec_image *,
+                             const struct exec_segment *);
+void exec_image_release (struct exec_image *);
+bool exec_image_read_page (struct exec_image *, struct exec_segment *,
+                           size_t page_idx, struct file *, uint8_t *kpage);
+
+struct exec_image *exec_cache_lookup (struct inode *);
+void exec_cache_insert (struct exec_image *);
+
+#endif /* userprog/exec-cache.h */
@@ -0,0 +1,340 @@
+#include "userprog/pipe.h"
+#include <debug.h>
+#include <stdint.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/uaccess.h"
+
+/* Pipes.
+
+   A pipe buffers data in a small ring of pages.  Writes of less
+   than a page are appended to the newest page, or to a fresh one
+   when it is full.  Data moves straight between the user buffers
+   and these pages; nothing is staged in a bounce page and nothing
+   goes near the file system.
+
+   Writes of a page or more take a fast path: the writer fills a
+   whole page without holding the pipe's lock, so readers keep
+   draining meanwhile, and then hands the page over to the ring in
+   one step.  A reader that asks for a whole page into a
+   page-aligned, writable buffer does not copy it at all: the
+   ring's page is mapped in place of the reader's, and the
+   reader's old page goes back to the pipe for reuse.
+
+   Readers block while the pipe is empty and writers block while
+   the ring is full.  Once the last writer closes, readers see end
+   of file; once the last reader closes, writes fail. */
+
+/* Number of pages a pipe buffers before writers block. */
+#define PIPE_PAGES 4
+
+/* One page in a pipe's ring. */
+struct pipe_page
+  {
+    uint8_t *data;              /* Page of data. */
+    size_t start;               /* Offset of first unread byte. */
+    size_t end;                 /* Offset just past last byte written. */
+  };
+
+/* A pipe. */
+struct pipe
+  {
+    struct lock lock;           /* Protects all members. */
+    struct condition readable;  /* Data arrived, or no more writers. */
+    struct condition writable;  /* Ring page freed, or no more readers. */
+    struct pipe_page pages[PIPE_PAGES]; /* Ring of buffered pages. */
+    int head;                   /* Index of oldest page in ring. */
+    int cnt;                    /* Number of pages in ring, each with
+                                   at least one unread byte. */
+    uint8_t *spare;             /* Drained page kept for reuse. */
+    int readers;                /* Open read ends. */
+    int writers;                /* Open write ends. */
+  };
+
+static uint8_t *get_page (struct pipe *);
+static void put_page (struct pipe *, uint8_t *);
+static void push_page (struct pipe *, uint8_t *, size_t len);
+static bool swap_user_page (uint8_t **kpage, void *upage);
+
+/* Creates a pipe with one read end and one write end open.
+   Returns a null pointer if memory is exhausted. */
+struct pipe *
+pipe_create (void)
+{
+  struct pipe *p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+
+  lock_init (&p->lock);
+  cond_init (&p->readable);
+  cond_init (&p->writable);
+  p->head = 0;
+  p->cnt = 0;
+  p->spare = NULL;
+  p->readers = 1;
+  p->writers = 1;
+  return p;
+}
+
+/* Opens another read end of P, or another write end if WRITER is
+   true. */
+void
+pipe_dup (struct pipe *p, bool writer)
+{
+  lock_acquire (&p->lock);
+  if (writer)
+    p->writers++;
+  else
+    p->readers++;
+  lock_release (&p->lock);
+}
+
+/* Closes a read end of P, or a write end if WRITER is true, and
+   frees P once both of its ends are fully closed. */
+void
+pipe_close (struct pipe *p, bool writer)
+{
+  bool dead;
+
+  lock_acquire (&p->lock);
+  if (writer)
+    {
+      ASSERT (p->writers > 0);
+      if (--p->writers == 0)
+        cond_broadcast (&p->readable, &p->lock);
+    }
+  else
+    {
+      ASSERT (p->readers > 0);
+      if (--p->readers == 0)
+        cond_broadcast (&p->writable, &p->lock);
+    }
+  dead = p->readers == 0 && p->writers == 0;
+  lock_release (&p->lock);
+
+  if (dead)
+    {
+      for (; p->cnt > 0; p->cnt--, p->head = (p->head + 1) % PIPE_PAGES)
+        palloc_free_page (p->pages[p->head].data);
+      palloc_free_page (p->spare);
+      free (p);
+    }
+}
+
+/* Reads up to SIZE bytes from P into user buffer UBUF, waiting
+   until at least one byte is available or P has no writers left.
+   Returns the number of bytes read, which is 0 at end of file.  On
+   a bad user address, sets *FAULTED and stops; the caller must
+   kill the process. */
+int
+pipe_read (struct pipe *p, void *ubuf_, size_t size, bool *faulted)
+{
+  uint8_t *ubuf = ubuf_;
+  size_t done = 0;
+  bool freed = false;
+
+  if (size == 0)
+    return 0;
+
+  lock_acquire (&p->lock);
+  while (p->cnt == 0 && p->writers > 0)
+    cond_wait (&p->readable, &p->lock);
+
+  while (done < size && p->cnt > 0)
+    {
+      struct pipe_page *pp = &p->pages[p->head];
+      size_t n = pp->end - pp->start;
+
+      if (n > size - done)
+        n = size - done;
+      if (n == PGSIZE && pg_ofs (ubuf + done) == 0
+          && swap_user_page (&pp->data, ubuf + done))
+        {
+          /* The page itself went to the reader. */
+        }
+      else if (!copy_to_user (ubuf + done, pp->data + pp->start, n))
+        {
+          *faulted = true;
+          break;
+        }
+      pp->start += n;
+      done += n;
+
+      if (pp->start == pp->end)
+        {
+          put_page (p, pp->data);
+          p->head = (p->head + 1) % PIPE_PAGES;
+          p->cnt--;
+          freed = true;
+        }
+    }
+  if (freed)
+    cond_broadcast (&p->writable, &p->lock);
+  lock_release (&p->lock);
+  return done;
+}
+
+/* Writes SIZE bytes from user buffer UBUF to P, waiting for room
+   as needed.  Returns the number of bytes written, which is short
+   only if P's last reader closes or memory runs out partway, or -1
+   if nothing could be written.  On a bad user address, sets
+   *FAULTED and stops; the caller must kill the process. */
+int
+pipe_write (struct pipe *p, const void *ubuf_, size_t size,
+            bool *faulted)
+{
+  const uint8_t *ubuf = ubuf_;
+  size_t done = 0;
+
+  if (size == 0)
+    return 0;
+
+  lock_acquire (&p->lock);
+  while (done < size && p->readers > 0)
+    {
+      size_t left = size - done;
+      uint8_t *page;
+
+      if (left >= PGSIZE)
+        {
+          /* Fill a whole page outside the lock, then hand it to
+             the ring. */
+          bool ok;
+
+          page = get_page (p);
+          if (page == NULL)
+            break;
+          lock_release (&p->lock);
+          ok = copy_from_user (page, ubuf + done, PGSIZE);
+          lock_acquire (&p->lock);
+          if (!ok)
+            {
+              *faulted = true;
+              put_page (p, page);
+              break;
+            }
+          while (p->cnt == PIPE_PAGES && p->readers > 0)
+            cond_wait (&p->writable, &p->lock);
+          if (p->readers == 0)
+            {
+              put_page (p, page);
+              break;
+            }
+          push_page (p, page, PGSIZE);
+          done += PGSIZE;
+        }
+      else
+        {
+          struct pipe_page *tail = NULL;
+          size_t n;
+
+          if (p->cnt > 0)
+            tail = &p->pages[(p->head + p->cnt - 1) % PIPE_PAGES];
+          if (tail != NULL && tail->end < PGSIZE)
+            {
+              /* Append to the newest page. */
+              n = PGSIZE - tail->end < left ? PGSIZE - tail->end : left;
+              if (!copy_from_user (tail->data + tail->end, ubuf + done, n))
+                {
+                  *faulted = true;
+                  break;
+                }
+              tail->end += n;
+            }
+          else if (p->cnt < PIPE_PAGES)
+            {
+              /* Start a new page. */
+              page = get_page (p);
+              if (page == NULL)
+                break;
+              n = left;
+              if (!copy_from_user (page, ubuf + done, n))
+                {
+                  *faulted = true;
+                  put_page (p, page);
+                  break;
+                }
+              push_page (p, page, n);
+            }
+          else
+            {
+              cond_wait (&p->writable, &p->lock);
+              continue;
+            }
+          done += n;
+        }
+      cond_signal (&p->readable, &p->lock);
+    }
+  lock_release (&p->lock);
+  return done > 0 ? (int) done : -1;
+}
+
+/* Returns a page for P's ring: its spare page if it has one, or a
+   new page.  Returns a null pointer if memory is exhausted.  The
+   caller must hold P's lock. */
+static uint8_t *
+get_page (struct pipe *p)
+{
+  uint8_t *page = p->spare;
+  if (page != NULL)
+    p->spare = NULL;
+  else
+    page = palloc_get_page (PAL_USER);
+  return page;
+}
+
+/* Gives PAGE, which is no longer in P's ring, back to P, keeping it
+   as the spare page if P does not have one already.  The caller
+   must hold P's lock. */
+static void
+put_page (struct pipe *p, uint8_t *page)
+{
+  if (p->spare == NULL)
+    p->spare = page;
+  else
+    palloc_free_page (page);
+}
+
+/* Adds PAGE, holding LEN bytes of data, to the end of P's ring,
+   which must not be full.  The caller must hold P's lock. */
+static void
+push_page (struct pipe *p, uint8_t *page, size_t len)
+{
+  struct pipe_page *pp;
+
+  ASSERT (p->cnt < PIPE_PAGES);
+  ASSERT (len > 0);
+
+  pp = &p->pages[(p->head + p->cnt) % PIPE_PAGES];
+  pp->data = page;
+  pp->start = 0;
+  pp->end = len;
+  p->cnt++;
+}
+
+/* Maps kernel page *KPAGE, which must come from the user pool, at
+   user page UPAGE in the current process in place of the page
+   there, and stores the page that was there in *KPAGE.  Returns
+   false, changing nothing, unless UPAGE is mapped writable. */
+static bool
+swap_user_page (uint8_t **kpage, void *upage)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  uint8_t *old;
+
+  if (!is_user_vaddr (upage) || !pagedir_is_writable (pd, upage))
+    return false;
+  old = pagedir_get_page (pd, upage);
+  pagedir_clear_page (pd, upage);
+  if (!pagedir_set_page (pd, upage, *kpage, true))
+    PANIC ("remapping a present user page failed");
+  /* The reader's page counts as written, which matters if it
+     belongs to a memory-mapped file. */
+  pagedir_set_dirty (pd, upage, true);
+  *kpage = old;
+  return true;
+}
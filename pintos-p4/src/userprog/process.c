@@ -1,12 +1,15 @@
 #include "userprog/process.h"
 #include <debug.h>
+#include <hash.h>
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/exec-cache.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
+#include "userprog/syscall.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
@@ -14,13 +17,40 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/synch.h"
+#include "vm/mmap.h"
+
+/* A child process as its parent sees it.  Outlives the child, so
+   that the parent can collect the child's exit status, until the
+   parent reaps it or exits itself. */
+struct child_wrapper
+  {
+    tid_t tid;                  /* Child's thread id. */
+    struct thread *parent;      /* Null once the parent has exited. */
+    bool exited;                /* Has the child exited? */
+    int exitstatus;             /* Child's exit status, once exited. */
+    struct list_elem elem;      /* In parent's children or
+                                   exited_children. */
+    struct hash_elem hash_elem; /* In child_table. */
+  };
+
+/* Wrappers of all children whose parents are still running, by
+   tid, so that wait() finds a child in constant time however many
+   its parent has had.  children_lock protects this table, every
+   child_wrapper, and each thread's lists of them. */
+static struct hash child_table;
+static struct lock children_lock;
 
 static thread_func start_process NO_RETURN;
-static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static bool load (const struct spawn_args *, void (**eip) (void), void **esp);
+static hash_hash_func child_hash;
+static hash_less_func child_less;
+static struct child_wrapper *child_lookup (tid_t);
+static int child_reap (struct child_wrapper *);
 
 
 #ifndef DEBUG_BULLSHIT
@@ -33,64 +63,159 @@ static bool load (const char *cmdline, void (**eip) (void), void **esp);
 #endif
 #endif
 
-char* space = " ";
+/* Initializes the table of child processes. */
+void
+process_init (void)
+{
+  hash_init (&child_table, child_hash, child_less, NULL);
+  lock_init (&children_lock);
+}
+
+/* Returns a new, empty spawn_args, or a null pointer if memory is
+   exhausted.  Free it with spawn_args_destroy(). */
+struct spawn_args *
+spawn_args_create (void)
+{
+  struct spawn_args *sa = palloc_get_page (0);
+  if (sa == NULL)
+    return NULL;
+  sa->file = sa->argv = NULL;
+  sa->argc = 0;
+  sa->argv_len = 0;
+  sa->action_cnt = 0;
+  sa->used = 0;
+  return sa;
+}
+
+/* Frees SA. */
+void
+spawn_args_destroy (struct spawn_args *sa)
+{
+  palloc_free_page (sa);
+}
 
 /* Starts a new thread running a user program loaded from
-   FILENAME.  The new thread may be scheduled (and may even exit)
-   before process_execute() returns.  Returns the new process's
-   thread id, or TID_ERROR if the thread cannot be created.
-*/
+   FILENAME, a command line whose first word names the program.
+   Returns once the program has loaded, with the new process's
+   thread id, or TID_ERROR if it could not be started. */
 tid_t
 process_execute (const char *file_name) 
 {
-  char *fn_copy;
+  struct spawn_args *sa;
+  char *token, *save_ptr, *end;
   tid_t tid;
 
-  /* Make a copy of FILE_NAME.
-     Otherwise there's a race between the caller and load(). */
-  fn_copy = palloc_get_page (0);
-  if (fn_copy == NULL)
+  sa = spawn_args_create ();
+  if (sa == NULL)
     return TID_ERROR;
-  strlcpy (fn_copy, file_name, PGSIZE);
 
-  /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (file_name, PRI_DEFAULT, start_process, fn_copy);
-  if (tid == TID_ERROR) 
-    palloc_free_page (fn_copy); 
+  /* Split the command line into arguments once, here, packing
+     them back to back at the start of the string storage.  Each
+     word moves down over the spaces before it, which strtok_r()
+     has already passed. */
+  if (strlcpy (sa->strings, file_name, SPAWN_STRINGS_MAX)
+      >= SPAWN_STRINGS_MAX)
+    {
+      spawn_args_destroy (sa);
+      return TID_ERROR;
+    }
+  end = sa->strings;
+  for (token = strtok_r (sa->strings, " ", &save_ptr); token != NULL;
+       token = strtok_r (NULL, " ", &save_ptr))
+    {
+      size_t len = strlen (token) + 1;
+      memmove (end, token, len);
+      end += len;
+      sa->argc++;
+    }
+  sa->file = sa->argv = sa->strings;
+  sa->argv_len = sa->used = end - sa->strings;
+
+  tid = sa->argc > 0 ? process_spawn (sa) : TID_ERROR;
+  spawn_args_destroy (sa);
+  return tid;
+}
 
+/* Starts a new thread running the user program described by SA,
+   which must stay valid until this returns.  Returns once the
+   program has loaded and its fds are set up, with the new
+   process's thread id, or TID_ERROR if it could not be started. */
+tid_t
+process_spawn (struct spawn_args *sa)
+{
+  struct thread *cur = thread_current ();
+  struct child_wrapper *w;
+  tid_t tid;
+
+  w = malloc (sizeof *w);
+  if (w == NULL)
+    return TID_ERROR;
+  w->parent = cur;
+  w->exited = false;
+  w->exitstatus = -1;
+
+  /* The child may exit as soon as it has loaded, so it must be on
+     our list before it starts. */
+  lock_acquire (&children_lock);
+  list_push_back (&cur->children, &w->elem);
+  lock_release (&children_lock);
+
+  sa->parent = cur;
+  sa->wrapper = w;
+  sema_init (&sa->loaded, 0);
+  sa->success = false;
+
+  tid = thread_create (sa->file, PRI_DEFAULT, start_process, sa);
+  lock_acquire (&children_lock);
+  if (tid == TID_ERROR)
+    {
+      list_remove (&w->elem);
+      free (w);
+    }
+  else
+    {
+      w->tid = tid;
+      hash_insert (&child_table, &w->hash_elem);
+    }
+  lock_release (&children_lock);
+  if (tid == TID_ERROR)
+    return TID_ERROR;
 
+  sema_down (&sa->loaded);
+  if (!sa->success)
+    {
+      /* The caller never learns the child's tid, so reap it here. */
+      process_wait (tid);
+      return TID_ERROR;
+    }
   return tid;
 }
 
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *sa_)
 {
-  char *file_name = file_name_;
+  struct spawn_args *sa = sa_;
   struct intr_frame if_;
   bool success;
 
+  thread_current ()->wrapper = sa->wrapper;
+
   /* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
+  success = (load (sa, &if_.eip, &if_.esp)
+             && syscall_spawn_fds (sa->parent, sa->actions, sa->action_cnt));
 
-
-  if (success) {
-    thread_current()->wrapper->loaded = 1;
-  }
-  else {
-    thread_current()->wrapper->loaded = -1;
-  }
-
-  sema_up(&thread_current()->load_semaphore);
-  
+  /* SA belongs to the parent, which may free it as soon as it
+     wakes up. */
+  sa->success = success;
+  sema_up (&sa->loaded);
 
   /* If load failed, quit. */
-  palloc_free_page (file_name);
   if (!success) {
     thread_exit ();
   }
@@ -110,45 +235,51 @@ start_process (void *file_name_)
    exception), returns -1.  If TID is invalid or if it was not a
    child of the calling process, or if process_wait() has already
    been successfully called for the given TID, returns -1
-   immediately, without waiting.
-
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
+   immediately, without waiting.  Once its status is collected the
+   child is forgotten, so a process keeps no state for the
+   children it has reaped. */
 int
 process_wait (tid_t child_tid) 
 {
-  struct thread *cur = thread_current();
-  struct child_wrapper* child;
-  struct list_elem *e;
-
-  for (e = list_begin (&cur->children); e != list_end (&cur->children);
-       e = list_next (e))
-  {
-    child = list_entry (e, struct child_wrapper, child_elem);
-    if (child -> tid == child_tid)
-      break;
-    else
-      child = NULL;
-  }
-  if (child == NULL)
-    return -1;
-  if (child->waitedfor == 1)
-    return -1;
-  child->waitedfor = 1;
-
-  // TODO:return -1 if killed by kernel?
-
-  if (child->exit_flag == 1) {
-    return child->exitstatus;
-  }
+  struct thread *cur = thread_current ();
+  struct child_wrapper *w;
+  int status = -1;
 
-  sema_down(&child->realchild->exit_semaphore);
+  lock_acquire (&children_lock);
+  w = child_lookup (child_tid);
+  if (w != NULL && w->parent == cur)
+    {
+      while (!w->exited)
+        cond_wait (&cur->child_exited, &children_lock);
+      status = child_reap (w);
+    }
+  lock_release (&children_lock);
+  return status;
+}
 
-  int ret = child -> exitstatus;
-  // TODO: we should free the resources, idk why the following causes page fault
-  // palloc_free_page(child);
-  return ret;
+/* Waits for any child of the calling process to die, reaps it,
+   and returns its tid, storing its exit status in *STATUS.
+   Children that have already exited are reaped in the order they
+   exited.  Returns TID_ERROR immediately if the calling process
+   has no children left to wait for. */
+tid_t
+process_wait_any (int *status)
+{
+  struct thread *cur = thread_current ();
+  tid_t tid = TID_ERROR;
 
+  lock_acquire (&children_lock);
+  while (list_empty (&cur->exited_children) && !list_empty (&cur->children))
+    cond_wait (&cur->child_exited, &children_lock);
+  if (!list_empty (&cur->exited_children))
+    {
+      struct child_wrapper *w = list_entry (list_front (&cur->exited_children),
+                                            struct child_wrapper, elem);
+      tid = w->tid;
+      *status = child_reap (w);
+    }
+  lock_release (&children_lock);
+  return tid;
 }
 
 /* Free the current process's resources. */
@@ -156,8 +287,12 @@ void
 process_exit (void)
 {
   struct thread *cur = thread_current ();
+  struct child_wrapper *w;
   uint32_t *pd;
 
+  syscall_exit ();
+  mmap_exit ();
+
   lock_acquire(&file_lock);
   if (cur->exe_file) {
     file_allow_write(cur->exe_file);
@@ -165,8 +300,6 @@ process_exit (void)
   }
   lock_release(&file_lock);
 
-  cur->wrapper->exit_flag = 1;
-  sema_up(&cur->exit_semaphore);
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur->pagedir;
@@ -187,7 +320,80 @@ process_exit (void)
       printf ("%s: exit(%d)\n", cur->name, cur->exitstatus);
     }
 
+  /* Hand our exit status to our parent, or drop it if the parent
+     is gone, and forget our own children.  Those still running
+     free their wrappers when they exit. */
+  lock_acquire (&children_lock);
+  w = cur->wrapper;
+  if (w != NULL)
+    {
+      w->exitstatus = cur->exitstatus;
+      w->exited = true;
+      if (w->parent != NULL)
+        {
+          list_remove (&w->elem);
+          list_push_back (&w->parent->exited_children, &w->elem);
+          cond_signal (&w->parent->child_exited, &children_lock);
+        }
+      else
+        free (w);
+      cur->wrapper = NULL;
+    }
+  while (!list_empty (&cur->children))
+    {
+      w = list_entry (list_pop_front (&cur->children),
+                      struct child_wrapper, elem);
+      hash_delete (&child_table, &w->hash_elem);
+      w->parent = NULL;
+    }
+  while (!list_empty (&cur->exited_children))
+    child_reap (list_entry (list_front (&cur->exited_children),
+                            struct child_wrapper, elem));
+  lock_release (&children_lock);
+}
+
+/* Returns the hash of child_wrapper E's tid. */
+static unsigned
+child_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct child_wrapper, hash_elem)->tid);
+}
 
+/* Returns true if child_wrapper A's tid is less than B's. */
+static bool
+child_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct child_wrapper, hash_elem)->tid
+          < hash_entry (b, struct child_wrapper, hash_elem)->tid);
+}
+
+/* Returns the wrapper of the child with the given TID whose parent
+   is still running, or a null pointer if there is none.  The
+   caller must hold children_lock. */
+static struct child_wrapper *
+child_lookup (tid_t tid)
+{
+  struct child_wrapper key;
+  struct hash_elem *e;
+
+  key.tid = tid;
+  e = hash_find (&child_table, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct child_wrapper, hash_elem) : NULL;
+}
+
+/* Frees W, the wrapper of an exited child, and returns the
+   child's exit status.  The caller must hold children_lock. */
+static int
+child_reap (struct child_wrapper *w)
+{
+  int status = w->exitstatus;
+
+  ASSERT (w->exited);
+  hash_delete (&child_table, &w->hash_elem);
+  list_remove (&w->elem);
+  free (w);
+  return status;
 }
 
 /* Sets up the CPU for running user code in the current
@@ -269,25 +475,28 @@ struct Elf32_Phdr
 #define PF_W 2          /* Writable. */
 #define PF_R 4          /* Readable. */
 
-static bool setup_stack (void **esp, const char *cmdline);
+static bool setup_stack (void **esp, const char *argv, int argc,
+                         size_t argv_len);
+static struct exec_image *parse_executable (struct file *,
+                                            const char *file_name);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
-static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
-                          uint32_t read_bytes, uint32_t zero_bytes,
-                          bool writable);
+static bool load_segment (struct exec_image *, struct exec_segment *,
+                          struct file *);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
+/* Loads the ELF executable SA->file into the current thread, with
+   SA's arguments on its stack.
    Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
    Returns true if successful, false otherwise. */
 bool
-load (const char *file_name, void (**eip) (void), void **esp) 
+load (const struct spawn_args *sa, void (**eip) (void), void **esp) 
 {
+  const char *file_name = sa->file;
   struct thread *t = thread_current ();
-  struct Elf32_Ehdr ehdr;
+  struct exec_image *img = NULL;
   struct file *file = NULL;
-  off_t file_ofs;
   bool success = false;
-  int i;
+  size_t i;
 
   /* Allocate and activate page directory. */
   t->pagedir = pagedir_create ();
@@ -296,13 +505,9 @@ load (const char *file_name, void (**eip) (void), void **esp)
   process_activate ();
 
   /* Open executable file. */
-  char file_name_copy[60];
-  strlcpy(file_name_copy, file_name, 60);
-  char* save_ptr;
-  char* file_name_real = strtok_r ( file_name_copy, " ", &save_ptr);
   lock_acquire(&file_lock);
   DEBUG_PRINT(("IN LOAD, ABOUT TO RUN FILESYS_OPEN\n"));
-  struct inode* fn_inode = filesys_open(file_name_real);
+  struct inode* fn_inode = filesys_open(file_name);
   if (fn_inode == NULL) {
     DEBUG_PRINT(("IN LOAD, FILESYS_OPEN FAILED\n"));
     printf ("load: %s: open failed\n", file_name);
@@ -323,7 +528,49 @@ load (const char *file_name, void (**eip) (void), void **esp)
   file_deny_write (file);
   lock_release(&file_lock);
 
+  /* Reuse the executable's parsed headers if they are cached. */
+  img = exec_cache_lookup (file_get_inode (file));
+  if (img == NULL)
+    {
+      img = parse_executable (file, file_name);
+      if (img == NULL)
+        goto done;
+      exec_cache_insert (img);
+    }
+
+  for (i = 0; i < img->segment_cnt; i++)
+    if (!load_segment (img, &img->segments[i], file))
+      goto done;
+
+  /* Set up stack. */
+  if (!setup_stack (esp, sa->argv, sa->argc, sa->argv_len))
+    goto done;
+
+  /* Start address. */
+  *eip = img->entry;
+
+  success = true;
+
+ done:
+  /* We arrive here whether the load is successful or not. */
+  exec_image_release (img);
+  return success;
+}
+
+/* Reads and checks the ELF headers of executable FILE, whose
+   name is FILE_NAME, and returns the parsed result with
+   a reference held by the caller.  Returns a null pointer if
+   FILE is not a valid executable or memory is exhausted. */
+static struct exec_image *
+parse_executable (struct file *file, const char *file_name)
+{
+  struct exec_image *img;
+  struct Elf32_Ehdr ehdr;
+  off_t file_ofs;
+  int i;
+
   /* Read and verify executable header. */
+  file_seek (file, 0);
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
       || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)
       || ehdr.e_type != 2
@@ -333,9 +580,14 @@ load (const char *file_name, void (**eip) (void), void **esp)
       || ehdr.e_phnum > 1024) 
     {
       printf ("load: %s: error loading executable\n", file_name);
-      goto done; 
+      return NULL;
     }
 
+  img = exec_image_create (file_get_inode (file));
+  if (img == NULL)
+    return NULL;
+  img->entry = (void (*) (void)) ehdr.e_entry;
+
   /* Read program headers. */
   file_ofs = ehdr.e_phoff;
   for (i = 0; i < ehdr.e_phnum; i++) 
@@ -343,11 +595,11 @@ load (const char *file_name, void (**eip) (void), void **esp)
       struct Elf32_Phdr phdr;
 
       if (file_ofs < 0 || file_ofs > file_length (file))
-        goto done;
+        goto error;
       file_seek (file, file_ofs);
 
       if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-        goto done;
+        goto error;
       file_ofs += sizeof phdr;
       switch (phdr.p_type) 
         {
@@ -361,53 +613,46 @@ load (const char *file_name, void (**eip) (void), void **esp)
         case PT_DYNAMIC:
         case PT_INTERP:
         case PT_SHLIB:
-          goto done;
+          goto error;
         case PT_LOAD:
           if (validate_segment (&phdr, file)) 
             {
-              bool writable = (phdr.p_flags & PF_W) != 0;
-              uint32_t file_page = phdr.p_offset & ~PGMASK;
-              uint32_t mem_page = phdr.p_vaddr & ~PGMASK;
+              struct exec_segment seg;
               uint32_t page_offset = phdr.p_vaddr & PGMASK;
-              uint32_t read_bytes, zero_bytes;
+
+              seg.writable = (phdr.p_flags & PF_W) != 0;
+              seg.file_page = phdr.p_offset & ~PGMASK;
+              seg.mem_page = (uint8_t *) (phdr.p_vaddr & ~PGMASK);
               if (phdr.p_filesz > 0)
                 {
                   /* Normal segment.
                      Read initial part from disk and zero the rest. */
-                  read_bytes = page_offset + phdr.p_filesz;
-                  zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-                                - read_bytes);
+                  seg.read_bytes = page_offset + phdr.p_filesz;
+                  seg.zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
+                                    - seg.read_bytes);
                 }
               else 
                 {
                   /* Entirely zero.
                      Don't read anything from disk. */
-                  read_bytes = 0;
-                  zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
+                  seg.read_bytes = 0;
+                  seg.zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
                 }
-              if (!load_segment (file, file_page, (void *) mem_page,
-                                 read_bytes, zero_bytes, writable))
-                goto done;
+              if (!exec_image_add_segment (img, &seg))
+                goto error;
             }
           else
-            goto done;
+            goto error;
           break;
         }
     }
-  /* Set up stack. */
-  if (!setup_stack (esp, file_name))
-    goto done;
-
-  /* Start address. */
-  *eip = (void (*) (void)) ehdr.e_entry;
+  return img;
 
-  success = true;
-
- done:
-  /* We arrive here whether the load is successful or not. */
-  return success;
+ error:
+  exec_image_release (img);
+  return NULL;
 }
-
+
 /* load() helpers. */
 
 static bool install_page (void *upage, void *kpage, bool writable);
@@ -457,148 +702,113 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
   return true;
 }
 
-/* Loads a segment starting at offset OFS in FILE at address
-   UPAGE.  In total, READ_BYTES + ZERO_BYTES bytes of virtual
-   memory are initialized, as follows:
+/* Loads segment SEG of executable IMG, whose contents are in
+   FILE, into the current process's address space.  In total,
+   SEG->read_bytes + SEG->zero_bytes bytes of virtual memory are
+   initialized, starting at SEG->mem_page, as follows:
 
-        - READ_BYTES bytes at UPAGE must be read from FILE
-          starting at offset OFS.
+        - SEG->read_bytes bytes must be read from FILE starting
+          at offset SEG->file_page, or copied from IMG's cached
+          pages.
 
-        - ZERO_BYTES bytes at UPAGE + READ_BYTES must be zeroed.
+        - SEG->zero_bytes bytes following them must be zeroed.
 
    The pages initialized by this function must be writable by the
-   user process if WRITABLE is true, read-only otherwise.
+   user process if SEG->writable is true, read-only otherwise.
 
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool
-load_segment (struct file *file, off_t ofs, uint8_t *upage,
-              uint32_t read_bytes, uint32_t zero_bytes, bool writable) 
+load_segment (struct exec_image *img, struct exec_segment *seg,
+              struct file *file) 
 {
-  ASSERT ((read_bytes + zero_bytes) % PGSIZE == 0);
+  uint8_t *upage = seg->mem_page;
+  size_t page_cnt = (seg->read_bytes + seg->zero_bytes) / PGSIZE;
+  size_t i;
+
+  ASSERT ((seg->read_bytes + seg->zero_bytes) % PGSIZE == 0);
   ASSERT (pg_ofs (upage) == 0);
-  ASSERT (ofs % PGSIZE == 0);
+  ASSERT (seg->file_page % PGSIZE == 0);
 
-  file_seek (file, ofs);
-  while (read_bytes > 0 || zero_bytes > 0) 
+  for (i = 0; i < page_cnt; i++) 
     {
-      /* Calculate how to fill this page.
-         We will read PAGE_READ_BYTES bytes from FILE
-         and zero the final PAGE_ZERO_BYTES bytes. */
-      size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-      size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
       /* Get a page of memory. */
       uint8_t *kpage = palloc_get_page (PAL_USER);
       if (kpage == NULL)
         return false;
 
       /* Load this page. */
-      if (file_read (file, kpage, page_read_bytes) != (int) page_read_bytes)
+      if (!exec_image_read_page (img, seg, i, file, kpage))
         {
           palloc_free_page (kpage);
           return false; 
         }
-      memset (kpage + page_read_bytes, 0, page_zero_bytes);
 
       /* Add the page to the process's address space. */
-      if (!install_page (upage, kpage, writable)) 
+      if (!install_page (upage, kpage, seg->writable)) 
         {
           palloc_free_page (kpage);
           return false; 
         }
 
       /* Advance. */
-      read_bytes -= page_read_bytes;
-      zero_bytes -= page_zero_bytes;
       upage += PGSIZE;
     }
   return true;
 }
 
 /* Create a minimal stack by mapping a zeroed page at the top of
-   user virtual memory. */
+   user virtual memory, and push the ARGC arguments in ARGV, which
+   are ARGV_LEN bytes in all, as main()'s argc and argv. */
 static bool
-setup_stack (void **esp, const char *cmdline) 
+setup_stack (void **esp, const char *argv, int argc, size_t argv_len) 
 {
   uint8_t *kpage;
-  bool success = false;
+  uint8_t *sp;
+  char **uargv;
+  char *uarg;
+  int i;
+
+  /* The strings, argv[] with its null terminator, argv, argc and
+     a return address must all fit in the one page. */
+  if (ROUND_UP (argv_len, sizeof (char *))
+      + (argc + 4) * sizeof (char *) > PGSIZE)
+    return false;
 
   kpage = palloc_get_page (PAL_USER | PAL_ZERO);
-  if (kpage != NULL) 
-  {
-    success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
-    if (success) {
-      *esp = PHYS_BASE;
-    }
-    else {
+  if (kpage == NULL)
+    return false;
+  if (!install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true))
+    {
       palloc_free_page (kpage);
-      return success;
+      return false;
     }
-  } else {return false;}
 
-  if (sizeof(cmdline) > PGSIZE) {
-    return false;
-  }
+  /* The page is mapped in the active page directory, so write
+     through its user address. */
+  sp = (uint8_t *) PHYS_BASE - argv_len;
+  memcpy (sp, argv, argv_len);
+  uarg = (char *) sp;
 
-  int MAX_ARGC = PGSIZE/sizeof(char*);
-  char* token;
-  char* saveptr;
-  int argc = 0;
-  int strlen_arg = 0;
-  struct thread *cur = thread_current ();
-  bool first = true;
-  for (token = strtok_r((char*)cmdline, " ", &saveptr); token != NULL;
-        token = strtok_r(NULL, " ", &saveptr)) {
-    if (first) strlcpy(cur->name, token, 60);
-    first = false;
-    strlen_arg =(strlen(token) + 1) * sizeof(char);
-    *esp -= strlen_arg;
-    memcpy(*esp, token, strlen_arg);
-    argc++;
-    if (argc >= MAX_ARGC) {
-      return false;
+  sp = (uint8_t *) ROUND_DOWN ((uintptr_t) sp, sizeof (char *));
+  sp -= (argc + 1) * sizeof (char *);
+  uargv = (char **) sp;
+  for (i = 0; i < argc; i++)
+    {
+      uargv[i] = uarg;
+      uarg += strlen (uarg) + 1;
     }
-  }
+  uargv[argc] = NULL;
 
-  char* argv_tracker = *esp;
-
-  // word_align and push argv[argc]
-  int word_align = (int)(*esp) % sizeof(char*);
-  *esp -= word_align;
-  memset(*esp, 0, word_align);
-  
-  *esp -= 4;
-  memset(*esp, 0, 4);
-  *esp -= 4;
-  memset(*esp, 0, 4);
-
-  void* top_of_argv = *esp - argc * sizeof(void*);
-  //*esp = top_of_argv;
-  //push cmd args to stack and copy address to argv
-  for (int i = argc-1; i >= 0; i--) {
-    memcpy(*esp, &argv_tracker, 4);
-    //*esp += sizeof (char*);
-    *esp -= sizeof(char*);
-    argv_tracker += strlen(argv_tracker) + 1;
-  }
-  *esp = top_of_argv;
-  //*esp -= sizeof (char*);
-  
-  // push argv
-  top_of_argv += 4;
-  *esp -= sizeof (char*);
-  memcpy(*esp, &top_of_argv, 4);
-
-  // push argc
-  *esp -= sizeof (int);
-  memcpy(*esp, &argc, sizeof(int));
-  // push fake return address
-  argc = 0;
-  *esp -= sizeof(char*);
-  memcpy(*esp, &argc, sizeof (void*));
+  sp -= sizeof (char **);
+  *(char ***) sp = uargv;
+  sp -= sizeof (int);
+  *(int *) sp = argc;
+  sp -= sizeof (void *);
+  *(void **) sp = NULL;             /* Fake return address. */
 
-  return success;
+  *esp = sp;
+  return true;
 }
 
 /* Adds a mapping from user virtual address UPAGE to kernel
@@ -1,10 +1,46 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <spawn.h>
+#include <stddef.h>
 #include "threads/thread.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 
+/* Everything needed to start a new process, built by the parent
+   and read by the child while it loads.  Occupies one page, the
+   strings living in STRINGS at the end of it. */
+struct spawn_args
+  {
+    char *file;                 /* Program to load. */
+    char *argv;                 /* ARGC null-terminated arguments,
+                                   back to back. */
+    int argc;                   /* Number of arguments in ARGV. */
+    size_t argv_len;            /* Bytes in ARGV, terminators included. */
+    struct spawn_action actions[SPAWN_ACTIONS_MAX]; /* Fd set-up. */
+    int action_cnt;             /* Number of ACTIONS. */
+
+    /* Set by process_spawn(). */
+    struct thread *parent;      /* Process SPAWN_DUP2 copies fds from. */
+    struct child_wrapper *wrapper; /* The child's, for its parent. */
+    struct semaphore loaded;    /* Upped once the child has started. */
+    bool success;               /* Did the child start? */
+
+    size_t used;                /* Bytes in use in STRINGS. */
+    char strings[];             /* Storage for the strings above. */
+  };
+
+/* Bytes available in a spawn_args's STRINGS. */
+#define SPAWN_STRINGS_MAX (PGSIZE - offsetof (struct spawn_args, strings))
+
+struct spawn_args *spawn_args_create (void);
+void spawn_args_destroy (struct spawn_args *);
+
+void process_init (void);
 tid_t process_execute (const char *file_name);
+tid_t process_spawn (struct spawn_args *);
 int process_wait (tid_t);
+tid_t process_wait_any (int *status);
 void process_exit (void);
 void process_activate (void);
 
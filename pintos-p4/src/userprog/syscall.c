@@ -1,5 +1,8 @@
 #include "userprog/syscall.h"
-#include "userprog/pagedir.h"
+#include "userprog/uaccess.h"
+#include "userprog/pipe.h"
+#include "userprog/uring.h"
+#include "vm/mmap.h"
 #include "threads/vaddr.h"
 #include "filesys/file.h"
 #include "filesys/directory.h"
@@ -15,6 +18,9 @@
 #include "threads/synch.h"
 #include "devices/input.h"
 #include <stdlib.h>
+#include <string.h>
+#include <iovec.h>
+#include <bitmap.h>
 
 static void syscall_handler (struct intr_frame *);
 static void copy_in (void *, const void *, size_t); 
@@ -38,19 +44,42 @@ static bool sys_readdir(uint8_t*);
 static bool sys_isdir(uint8_t*);
 static int sys_inumber(uint8_t*);
 
-void check_buffer(const void *buffer, unsigned size);
-void check_ptr(const void *ptr);
-void check_str (const void* str);
+static int sys_copy_file_range(uint8_t*);
+static int sys_pread(uint8_t*);
+static int sys_pwrite(uint8_t*);
+static int sys_readv(uint8_t*);
+static int sys_writev(uint8_t*);
+static int sys_uring_setup(uint8_t*);
+static int sys_uring_enter(uint8_t*);
+static pid_t sys_spawn(uint8_t*);
+static int sys_pipe(uint8_t*);
+static pid_t sys_wait_any(uint8_t*);
+static int sys_mmap(uint8_t*);
+static int sys_munmap(uint8_t*);
+static char *spawn_copy_in (struct spawn_args *, const char *);
+static int vectored_io (uint8_t*, bool write);
+static int fd_io (int fd, void *, off_t size, off_t ofs, bool write);
+static int xfer_pipe (struct pipe *, uint8_t *, off_t size, bool write,
+                      bool *faulted);
+static int xfer_user (struct file *, uint8_t *, off_t size, off_t ofs,
+                      bool write, bool *faulted);
+
+static void kill_process (void) NO_RETURN;
+static char *copy_in_str (const char *);
 struct file_in_thread* get_file(int fd);
-
-
-struct file_in_thread {
-  struct file *fileptr;
-  struct dir *dirptr;
-  int fd;
-  struct list_elem file_elem;
-};
-
+static struct file_in_thread *fd_wrap (struct file *);
+static struct file_in_thread *fd_wrap_pipe (struct pipe *, bool writer);
+static void fd_unwrap (struct file_in_thread *);
+static int fd_insert (struct thread *, struct file_in_thread *);
+static int fd_alloc (struct thread *, struct file_in_thread *);
+static int fd_place (struct thread *, struct file_in_thread *, int fd);
+static void fd_place_console (struct thread *, int fd);
+static void fd_release (struct thread *, int fd);
+static bool fd_table_grow (struct thread *);
+
+/* Initial number of slots in a process's fd table.  The table
+   doubles whenever it fills up. */
+#define FD_TABLE_INIT 16
 
 #ifndef DEBUG_BULLSHIT
 #define DEBUG_BULLSHIT
@@ -62,47 +91,336 @@ struct file_in_thread {
 #endif
 #endif
 
+/* Returns the open file for FD in the current process, or NULL if
+   FD is not open or is a pipe end. */
 struct file_in_thread*
 get_file(int fd) {
+  struct file_in_thread *file = fd_lookup(thread_current(), fd);
+  return file != NULL && file->pipe == NULL ? file : NULL;
+}
+
+/* Returns the open file for FD in process T, or NULL if FD is not
+   open.  Constant time: FD indexes the fd table.  The caller must
+   hold file_lock, even for the current thread, whose fd table a
+   ring worker may change. */
+struct file_in_thread*
+fd_lookup(struct thread *t, int fd) {
+  if (fd < 0 || (size_t) fd >= t->fd_table_size)
+    return NULL;
+  return t->fd_table[fd];
+}
+
+/* Gives FILE, which the caller has just opened, the lowest free fd
+   in process T and returns that fd.  If FILE is a directory, also
+   opens it as one for readdir().  On failure closes FILE and
+   returns -1.  The caller must hold file_lock. */
+int
+fd_install(struct thread *t, struct file *file) {
+  return fd_insert(t, fd_wrap(file));
+}
+
+/* Like fd_install(), but gives FILE descriptor FD, closing
+   whatever FD referred to before.  FD may be 0 or 1, in which case
+   FILE takes the place of the console.  Returns FD, or -1 on
+   failure.  The caller must hold file_lock. */
+int
+fd_install_at(struct thread *t, struct file *file, int fd) {
+  struct file_in_thread *new_file = fd_wrap(file);
+  if (new_file == NULL)
+    return -1;
+
+  if (fd_place(t, new_file, fd) < 0) {
+    fd_unwrap(new_file);
+    return -1;
+  }
+  return fd;
+}
+
+/* Closes FD in process T.  Returns false if FD was not open.  The
+   caller must hold file_lock. */
+bool
+fd_close(struct thread *t, int fd) {
+  struct file_in_thread* file = fd_lookup(t, fd);
+  if (file == NULL)
+    return false;
+  fd_release(t, fd);
+  fd_unwrap(file);
+  return true;
+}
+
+/* Returns true if a transfer on FD in process T goes to the
+   console: a read from fd 0 or a write to fd 1, unless a file has
+   been installed there.  The caller must hold file_lock, even for
+   the current thread, whose fd table a ring worker may change. */
+bool
+fd_is_console(struct thread *t, int fd, bool write) {
+  return ((fd == 0 && !write) || (fd == 1 && write))
+         && fd_lookup(t, fd) == NULL;
+}
+
+/* Gives the current process, started by spawn() from PARENT, the
+   CNT fds described by ACTIONS, in order.  A copy of the parent's
+   console can only go to fd 0 or 1, where the console lives.
+   Returns false if any of them cannot be set up. */
+bool
+syscall_spawn_fds (struct thread *parent, const struct spawn_action *actions,
+                   int cnt) {
   struct thread *cur = thread_current();
-  struct file_in_thread *target_file;
-  struct list_elem *e;
-  for (e = list_begin (&cur->file_list); e != list_end (&cur->file_list);
-       e = list_next (e))
-  {
-    target_file = list_entry (e, struct file_in_thread, file_elem);
-    if (target_file->fd == fd)
+  bool success = true;
+  int i;
+
+  lock_acquire(&file_lock);
+  for (i = 0; i < cnt && success; i++) {
+    const struct spawn_action *a = &actions[i];
+    struct file_in_thread *new_file = NULL;
+
+    if (a->fd < 0 || a->fd > SPAWN_FD_MAX) {
+      success = false;
       break;
-    else
-      target_file = NULL;
+    }
+    if (a->op == SPAWN_OPEN) {
+      struct file *file = file_open(filesys_open(a->path));
+      if (file != NULL)
+        new_file = fd_wrap(file);
+    }
+    else if (a->op == SPAWN_DUP2
+             && fd_is_console(parent, a->src_fd, a->src_fd == 1)) {
+      success = a->fd == 0 || a->fd == 1;
+      if (success)
+        fd_place_console(cur, a->fd);
+      continue;
+    }
+    else if (a->op == SPAWN_DUP2) {
+      /* The parent is blocked in spawn(), so its table is stable,
+         but the copy of a file gets its own position.  A pipe end
+         is shared outright. */
+      struct file_in_thread *src = fd_lookup(parent, a->src_fd);
+      if (src != NULL && src->pipe != NULL) {
+        pipe_dup(src->pipe, src->writer);
+        new_file = fd_wrap_pipe(src->pipe, src->writer);
+      }
+      else if (src != NULL) {
+        struct file *file = file_reopen(src->fileptr);
+        if (file != NULL) {
+          file_seek(file, file_tell(src->fileptr));
+          new_file = fd_wrap(file);
+        }
+      }
+    }
+    success = new_file != NULL;
+    if (success && fd_place(cur, new_file, a->fd) < 0) {
+      fd_unwrap(new_file);
+      success = false;
+    }
   }
-  return target_file;
+  lock_release(&file_lock);
+  return success;
 }
 
-void
-check_str (const void* str) {
-  void *ptr = pagedir_get_page(thread_current()->pagedir, str);
-  if (ptr == NULL) {
-    thread_current()->exitstatus = -1;
-    thread_exit();
+/* Wraps FILE, which the caller has just opened, in a new fd table
+   entry, also opening it as a directory if it is one.  On failure
+   closes FILE and returns a null pointer. */
+static struct file_in_thread *
+fd_wrap (struct file *file) {
+  struct file_in_thread *new_file = malloc(sizeof(struct file_in_thread));
+  if (new_file == NULL) {
+    file_close(file);
+    return NULL;
   }
+  new_file->fileptr = file;
+  new_file->pipe = NULL;
+  new_file->writer = false;
+
+  // if the file is a directory
+  struct inode *inode = file_get_inode(new_file->fileptr);
+  if(inode != NULL && inode_get_type (inode) == DIR) {
+    new_file->dirptr = dir_open(inode_reopen(inode));
+  }
+  else
+    new_file->dirptr = NULL;
+  return new_file;
 }
 
-void
-check_ptr(const void *ptr) {
-  if (ptr == NULL || !is_user_vaddr(ptr) || !pagedir_get_page(thread_current()->pagedir, ptr) ) {
-    thread_current()->exitstatus = -1;
-    thread_exit();
+/* Wraps an end of PIPE, the write end if WRITER is true, in a new
+   fd table entry.  The caller must already hold a reference to
+   that end, which the entry takes over.  On failure closes that
+   end and returns a null pointer. */
+static struct file_in_thread *
+fd_wrap_pipe (struct pipe *pipe, bool writer) {
+  struct file_in_thread *new_file = malloc(sizeof(struct file_in_thread));
+  if (new_file == NULL) {
+    pipe_close(pipe, writer);
+    return NULL;
+  }
+  new_file->fileptr = NULL;
+  new_file->dirptr = NULL;
+  new_file->pipe = pipe;
+  new_file->writer = writer;
+  return new_file;
+}
+
+/* Closes the file or pipe end in fd table entry FILE and frees the
+   entry. */
+static void
+fd_unwrap (struct file_in_thread *file) {
+  if (file->pipe != NULL)
+    pipe_close(file->pipe, file->writer);
+  else
+    file_close(file->fileptr);
+  if (file->dirptr != NULL)
+    dir_close(file->dirptr);
+  free(file);
+}
+
+/* Gives fd table entry FILE the lowest free fd in process T and
+   returns that fd.  On failure, or if FILE is null, frees FILE and
+   returns -1. */
+static int
+fd_insert (struct thread *t, struct file_in_thread *file) {
+  int fd;
+
+  if (file == NULL)
+    return -1;
+  fd = fd_alloc(t, file);
+  if (fd < 0)
+    fd_unwrap(file);
+  return fd;
+}
+
+/* Installs FILE in the current process's fd table at the lowest
+   free fd, growing the table if it is full.  Returns the new fd,
+   or -1 if memory is exhausted. */
+static int
+fd_alloc (struct thread *cur, struct file_in_thread *file) {
+  size_t fd = BITMAP_ERROR;
+
+  if (cur->fd_map != NULL)
+    fd = bitmap_scan_and_flip (cur->fd_map, 0, 1, false);
+  if (fd == BITMAP_ERROR) {
+    if (!fd_table_grow (cur))
+      return -1;
+    fd = bitmap_scan_and_flip (cur->fd_map, 0, 1, false);
+    ASSERT (fd != BITMAP_ERROR);
+  }
+  cur->fd_table[fd] = file;
+  file->fd = fd;
+  return fd;
+}
+
+/* Installs FILE in process CUR's fd table at FD, closing what was
+   there and growing the table as needed.  Returns FD, or -1 if
+   memory is exhausted. */
+static int
+fd_place (struct thread *cur, struct file_in_thread *file, int fd) {
+  struct file_in_thread *old;
+
+  while ((size_t) fd >= cur->fd_table_size)
+    if (!fd_table_grow (cur))
+      return -1;
+  old = cur->fd_table[fd];
+  if (old != NULL)
+    fd_unwrap (old);
+  bitmap_mark (cur->fd_map, fd);
+  cur->fd_table[fd] = file;
+  file->fd = fd;
+  return fd;
+}
+
+/* Gives FD, which must be 0 or 1, back to the console in process
+   CUR, closing what was there. */
+static void
+fd_place_console (struct thread *cur, int fd) {
+  ASSERT (fd == 0 || fd == 1);
+  if ((size_t) fd >= cur->fd_table_size)
+    return;
+  if (cur->fd_table[fd] != NULL)
+    fd_unwrap (cur->fd_table[fd]);
+  cur->fd_table[fd] = NULL;
+  bitmap_mark (cur->fd_map, fd);
+}
+
+/* Marks FD free in process CUR's fd table. */
+static void
+fd_release (struct thread *cur, int fd) {
+  cur->fd_table[fd] = NULL;
+  bitmap_reset (cur->fd_map, fd);
+}
+
+/* Doubles the size of T's fd table, creating it on first use with
+   fds 0 and 1 reserved for the console.  Returns false if memory
+   is exhausted, leaving the old table intact. */
+static bool
+fd_table_grow (struct thread *t) {
+  size_t new_size = t->fd_table_size ? t->fd_table_size * 2 : FD_TABLE_INIT;
+  struct file_in_thread **new_table;
+  struct bitmap *new_map;
+  size_t i;
+
+  new_map = bitmap_create (new_size);
+  if (new_map == NULL)
+    return false;
+  new_table = realloc (t->fd_table, new_size * sizeof *new_table);
+  if (new_table == NULL) {
+    bitmap_destroy (new_map);
+    return false;
+  }
+  for (i = t->fd_table_size; i < new_size; i++)
+    new_table[i] = NULL;
+
+  if (t->fd_map == NULL)
+    bitmap_set_multiple (new_map, 0, 2, true);
+  else {
+    for (i = 0; i < t->fd_table_size; i++)
+      bitmap_set (new_map, i, bitmap_test (t->fd_map, i));
+    bitmap_destroy (t->fd_map);
   }
+  t->fd_table = new_table;
+  t->fd_map = new_map;
+  t->fd_table_size = new_size;
+  return true;
 }
 
+/* Closes every file the current process still has open and frees
+   its fd table.  Called from process_exit(). */
 void
-check_buffer(const void *buffer, unsigned size) {
-  char *temp = (char*)buffer;
-  for (unsigned i=0; i<size; i++) {
-    check_ptr((const void*)temp);
-    temp++;
+syscall_exit (void) {
+  struct thread *cur = thread_current();
+  size_t fd;
+
+  uring_exit();
+  if (cur->fd_table == NULL)
+    return;
+  lock_acquire(&file_lock);
+  for (fd = 0; fd < cur->fd_table_size; fd++) {
+    struct file_in_thread *file = cur->fd_table[fd];
+    if (file != NULL)
+      fd_unwrap(file);
   }
+  lock_release(&file_lock);
+  free(cur->fd_table);
+  bitmap_destroy(cur->fd_map);
+  cur->fd_table = NULL;
+  cur->fd_map = NULL;
+  cur->fd_table_size = 0;
+}
+
+/* Terminates the current process with exit status -1, as when it
+   passes the kernel a bad pointer. */
+static void
+kill_process (void) {
+  thread_current()->exitstatus = -1;
+  thread_exit();
+}
+
+/* Copies user string US into a kernel page that the caller must
+   free with palloc_free_page(), killing the process if US is not
+   a valid user string. */
+static char *
+copy_in_str (const char *us) {
+  char *ks = copy_in_string(us);
+  if (ks == NULL)
+    kill_process();
+  return ks;
 }
 
 //static char * copy_in_string (const char *);
@@ -110,6 +428,8 @@ void
 syscall_init (void) 
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+  uring_init ();
+  mmap_init ();
 }
 
 /* System call handler. */
@@ -160,6 +480,30 @@ syscall_handler (struct intr_frame *f)
     break;
   case SYS_INUMBER: syscall = sys_inumber;
     break;
+  case SYS_COPY_FILE_RANGE: syscall = sys_copy_file_range;
+    break;
+  case SYS_PREAD: syscall = sys_pread;
+    break;
+  case SYS_PWRITE: syscall = sys_pwrite;
+    break;
+  case SYS_READV: syscall = sys_readv;
+    break;
+  case SYS_WRITEV: syscall = sys_writev;
+    break;
+  case SYS_URING_SETUP: syscall = sys_uring_setup;
+    break;
+  case SYS_URING_ENTER: syscall = sys_uring_enter;
+    break;
+  case SYS_SPAWN: syscall = sys_spawn;
+    break;
+  case SYS_PIPE: syscall = sys_pipe;
+    break;
+  case SYS_WAIT_ANY: syscall = sys_wait_any;
+    break;
+  case SYS_MMAP: syscall = sys_mmap;
+    break;
+  case SYS_MUNMAP: syscall = sys_munmap;
+    break;
   default:
     syscall = NULL;
     break;
@@ -181,29 +525,143 @@ static pid_t sys_exec (uint8_t* args_start) {
   DEBUG_PRINT(("SYS_EXEC\n"));
   char *cmd_line;
   copy_in (&cmd_line, args_start, sizeof(char*));
-  check_str(cmd_line);
+  cmd_line = copy_in_str(cmd_line);
   
+  // returns once the child has loaded, or failed to
   pid_t process_id = process_execute((const char*)cmd_line);
+  palloc_free_page(cmd_line);
   if (process_id == TID_ERROR)
     return -1;
+  DEBUG_PRINT(("RETURN SYS_EXEC\n"));
 
-  // find this process in current thread's children list
-  struct child_wrapper* child = thread_current()->cur_child;
-  if (child == NULL)
+  return process_id;
+
+}
+
+/* Starts program FILE with the null-terminated argument list ARGV
+   and the ACTION_CNT fd set-up actions in ACTIONS.  Unlike exec,
+   the arguments arrive already split, and the child's fds are set
+   up before it runs.  Returns once the child has loaded, with its
+   pid, or -1 if it could not be started. */
+static pid_t
+sys_spawn(uint8_t* args_start)
+{
+  const char *ufile;
+  char *const *uargv;
+  const struct spawn_action *uactions;
+  int action_cnt, i;
+  struct spawn_args *sa;
+  pid_t pid;
+
+  copy_in (&ufile, args_start, sizeof(int));
+  copy_in (&uargv, args_start + sizeof(int), sizeof(int));
+  copy_in (&uactions, args_start + 2 * sizeof(int), sizeof(int));
+  copy_in (&action_cnt, args_start + 3 * sizeof(int), sizeof(int));
+  if (action_cnt < 0 || action_cnt > SPAWN_ACTIONS_MAX)
     return -1;
 
-  // wait for the child process to load
-  if (child->loaded == 0) {
-    sema_down(&child->realchild->load_semaphore);
-  }
-  if (child->loaded == -1) {   // failed to load
-    // child->exit_flag = 1;
+  sa = spawn_args_create();
+  if (sa == NULL)
     return -1;
+  if (!copy_from_user (sa->actions, uactions,
+                       action_cnt * sizeof *sa->actions)) {
+    spawn_args_destroy(sa);
+    kill_process();
   }
-  DEBUG_PRINT(("RETURN SYS_EXEC\n"));
+  sa->action_cnt = action_cnt;
+
+  /* The program name, then the arguments back to back, then any
+     paths the actions need. */
+  sa->file = spawn_copy_in(sa, ufile);
+  if (sa->file == NULL)
+    goto fail;
+  sa->argv = sa->strings + sa->used;
+  for (;;) {
+    const char *uarg;
+    if (!copy_from_user (&uarg, uargv + sa->argc, sizeof uarg)) {
+      spawn_args_destroy(sa);
+      kill_process();
+    }
+    if (uarg == NULL)
+      break;
+    if (spawn_copy_in(sa, uarg) == NULL)
+      goto fail;
+    sa->argc++;
+  }
+  sa->argv_len = sa->strings + sa->used - sa->argv;
+  if (sa->argc == 0)
+    goto fail;
+  for (i = 0; i < action_cnt; i++)
+    if (sa->actions[i].op == SPAWN_OPEN) {
+      sa->actions[i].path = spawn_copy_in(sa, sa->actions[i].path);
+      if (sa->actions[i].path == NULL)
+        goto fail;
+    }
 
-  return process_id;
+  pid = process_spawn(sa);
+  spawn_args_destroy(sa);
+  return pid == TID_ERROR ? -1 : pid;
 
+ fail:
+  spawn_args_destroy(sa);
+  return -1;
+}
+
+/* Appends user string US to SA's string storage and returns the
+   copy, or a null pointer if it does not fit.  Kills the process,
+   after freeing SA, if US is not a valid user string. */
+static char *
+spawn_copy_in (struct spawn_args *sa, const char *us)
+{
+  char *ks = sa->strings + sa->used;
+  size_t i;
+
+  for (i = 0; sa->used + i < SPAWN_STRINGS_MAX; i++) {
+    if (!get_user ((uint8_t *) ks + i, (const uint8_t *) us + i)) {
+      spawn_args_destroy(sa);
+      kill_process();
+    }
+    if (ks[i] == '\0') {
+      sa->used += i + 1;
+      return ks;
+    }
+  }
+  return NULL;
+}
+
+/* Creates a pipe and stores the fds of its read and write ends in
+   the user's FDS[0] and FDS[1].  Returns 1 if successful, 0 if the
+   pipe or its fds cannot be allocated. */
+static int
+sys_pipe(uint8_t* args_start)
+{
+  int *ufds;
+  int fds[2];
+  struct thread *cur = thread_current();
+  struct pipe *pipe;
+
+  copy_in (&ufds, args_start, sizeof(int*));
+
+  pipe = pipe_create();
+  if (pipe == NULL)
+    return 0;
+  lock_acquire(&file_lock);
+  fds[0] = fd_insert(cur, fd_wrap_pipe(pipe, false));
+  fds[1] = fd_insert(cur, fd_wrap_pipe(pipe, true));
+  if (fds[0] < 0 || fds[1] < 0) {
+    if (fds[0] >= 0)
+      fd_close(cur, fds[0]);
+    if (fds[1] >= 0)
+      fd_close(cur, fds[1]);
+    lock_release(&file_lock);
+    return 0;
+  }
+  lock_release(&file_lock);
+
+  /* On a bad FDS, process exit closes both ends. */
+  if (!copy_to_user(ufds, fds, sizeof fds))
+    kill_process();
+  return 1;
 }
 
 static int sys_wait (uint8_t* args_start) {
@@ -212,6 +670,61 @@ static int sys_wait (uint8_t* args_start) {
   return process_wait(child_id);
 }
 
+/* Waits for any child to exit and returns its pid, storing its
+   exit status in *STATUS unless STATUS is null.  Returns -1 if
+   there are no children left to wait for. */
+static pid_t
+sys_wait_any(uint8_t* args_start)
+{
+  int *ustatus;
+  int status;
+  tid_t tid;
+  copy_in (&ustatus, args_start, sizeof(int*));
+
+  tid = process_wait_any(&status);
+  if (tid == TID_ERROR)
+    return -1;
+  if (ustatus != NULL && !copy_to_user(ustatus, &status, sizeof status))
+    kill_process();
+  return tid;
+}
+
+/* Maps the file open as FD into memory at ADDR.  The mapping has
+   its own handle on the file, so it outlives closing FD.  Returns
+   the mapping's identifier, or -1 if FD is not an open regular
+   file or the file cannot be mapped at ADDR. */
+static int
+sys_mmap(uint8_t* args_start)
+{
+  int fd;
+  void *addr;
+  struct file_in_thread *file;
+  struct file *mapped = NULL;
+  copy_in (&fd, args_start, sizeof(int));
+  copy_in (&addr, args_start + sizeof(int), sizeof(void*));
+
+  lock_acquire(&file_lock);
+  file = get_file(fd);
+  if (file != NULL && file->dirptr == NULL)
+    mapped = file_reopen(file->fileptr);
+  lock_release(&file_lock);
+  if (mapped == NULL)
+    return -1;
+  return mmap_map(mapped, addr);
+}
+
+/* Unmaps mapping MAPID, writing back the pages written through it.
+   Does nothing if there is no such mapping.  Returns 0, which user
+   space ignores. */
+static int
+sys_munmap(uint8_t* args_start)
+{
+  int mapid;
+  copy_in (&mapid, args_start, sizeof(int));
+  mmap_unmap(mapid);
+  return 0;
+}
+
 static bool sys_create (uint8_t* args_start) {
   DEBUG_PRINT(("SYS_CREATE\n"));
   char *file_name;
@@ -219,12 +732,12 @@ static bool sys_create (uint8_t* args_start) {
   copy_in (&file_name, args_start, sizeof(char*));
   copy_in (&size, args_start + sizeof(char*), sizeof(int));
 
-  check_ptr(file_name);
-  check_str(file_name);
+  file_name = copy_in_str(file_name);
 
   lock_acquire(&file_lock);
   bool status = filesys_create(file_name, size, FILE);
   lock_release(&file_lock);
+  palloc_free_page(file_name);
   DEBUG_PRINT(("RETURN SYS_CREATE\n"));
   return status;
 }
@@ -233,81 +746,38 @@ static bool sys_remove (uint8_t* args_start) {
   DEBUG_PRINT(("SYS_REMOVE\n"));
   char *file_name;
   copy_in (&file_name, args_start, sizeof(char*));
-  check_ptr(file_name);
-  check_str(file_name);
+  file_name = copy_in_str(file_name);
   lock_acquire(&file_lock);
   bool status = filesys_remove(file_name);
   lock_release(&file_lock);
+  palloc_free_page(file_name);
   DEBUG_PRINT(("RETURN SYS_REMOVE\n"));
   return status;
 }
 
 static int sys_read (uint8_t* args_start) {
-  // if (args_start == NULL)
-  //   return -1;
   int fd;
   void* buffer;
   unsigned size;
   copy_in (&fd, args_start, sizeof(int));
   copy_in (&buffer, args_start + sizeof(int), sizeof(int));
   copy_in (&size, args_start + 2 *sizeof(int), sizeof(int));
-  check_buffer(buffer, size);
-  int retval = 0;
-  if (fd == 0) {
-    unsigned i;
-    uint8_t *store = (uint8_t *)buffer;
-    for (i = 0;i < size; i++) {
-      store[i] = input_getc();
-    }
-    return size;
-  }
-  else {
-    lock_acquire(&file_lock);
-    struct file_in_thread* file = get_file(fd);
-    if (file == NULL) {
-      lock_release(&file_lock);
-      return -1;
-    } 
-    retval = file_read(file->fileptr, buffer, size);
-    lock_release(&file_lock);
-  }
-  return retval;
+  if (size > INT32_MAX)
+    return -1;
+  return fd_io(fd, buffer, size, -1, false);
 }
 
 /* Write system call. */
 static int sys_write (uint8_t* args_start) {
   int fd;
-  const void* buffer;
+  void* buffer;
   unsigned size;
   copy_in (&fd, args_start, sizeof(int));
   copy_in (&buffer, args_start + sizeof(int), sizeof(int));
   copy_in (&size, args_start + 2 *sizeof(int), sizeof(int));
-  check_buffer(buffer, size);
-
-  int size_to_write = size;
-  int retval = 0;
-  // if the handle is stdout, need to do chunks at a time until sizetowrite is zero
-  if (fd == 1) {
-    int write_amt;
-    write_amt = size_to_write > 300 ? 300 : size_to_write;
-    while (size_to_write > 0) {
-      putbuf (buffer + retval, write_amt);
-      retval += write_amt;
-      size_to_write -= write_amt;
-    }
-  }
-  else {
-    lock_acquire(&file_lock);
-    struct file_in_thread* file = get_file(fd);
-
-    if (file == NULL) {
-      lock_release(&file_lock);
-      return -1;
-    } 
-    retval = file_write(file->fileptr, buffer, size);
-    lock_release(&file_lock);
-  }
-  return retval;
+  if (size > INT32_MAX)
+    return -1;
+  return fd_io(fd, buffer, size, -1, true);
 }
 
 static int sys_exit(uint8_t* args_start) {
@@ -316,7 +786,6 @@ static int sys_exit(uint8_t* args_start) {
   copy_in (&status_code, args_start, sizeof(int));
   struct thread *cur = thread_current ();
   cur->exitstatus = status_code;
-  cur->wrapper->exitstatus = status_code;
   thread_exit ();
 
   return status_code;
@@ -327,32 +796,15 @@ static int sys_open(uint8_t* args_start) {
   char *file_name;
   copy_in (&file_name, args_start, sizeof(char*));
 
-  check_ptr(file_name);
-  check_str(file_name);
+  file_name = copy_in_str(file_name);
 
   lock_acquire(&file_lock);
   struct file *file = file_open(filesys_open ((const char *)file_name));
-  if (file == NULL) {
-    lock_release(&file_lock);
-    return -1;
-  }
-  struct file_in_thread *new_file = malloc(sizeof(struct file_in_thread));
-  new_file->fileptr = file;
-
-  // if the file is a directory
-  struct inode *inode = file_get_inode(new_file->fileptr);
-  if(inode != NULL && inode_get_type (inode) == DIR) {
-    new_file->dirptr = dir_open(inode_reopen(inode));
-  }
-  else
-    new_file->dirptr = NULL;
-
-  new_file->fd = thread_current()->fd;
-  thread_current()->fd++;
-  list_push_back(&thread_current()->file_list, &new_file->file_elem);
+  palloc_free_page(file_name);
+  int fd = file != NULL ? fd_install(thread_current(), file) : -1;
   lock_release(&file_lock);
   DEBUG_PRINT(("FINISHED SYS_OPEN\n"));
-  return new_file->fd;
+  return fd;
 }
 
 static int sys_filesize(uint8_t* args_start) {
@@ -360,6 +812,10 @@ static int sys_filesize(uint8_t* args_start) {
   copy_in (&fd, args_start, sizeof(int));
   lock_acquire(&file_lock);
   struct file_in_thread* file = get_file(fd);
+  if (file == NULL) {
+    lock_release(&file_lock);
+    return -1;
+  }
   int filesize = file_length(file->fileptr);
   lock_release(&file_lock);
   return filesize;
@@ -402,16 +858,7 @@ static void sys_close (uint8_t* args_start) {
   copy_in (&fd, args_start, sizeof(int));
 
   lock_acquire(&file_lock);
-  struct file_in_thread* file = get_file(fd);
-  if (file == NULL) {
-    lock_release(&file_lock);
-    return;
-  }
-  file_close(file->fileptr);
-  if (file->dirptr != NULL)
-    dir_close(file->dirptr);
-  list_remove(&file->file_elem);
-  free(file);
+  fd_close(thread_current(), fd);
   lock_release(&file_lock);
   DEBUG_PRINT(("RETURN SYS_CLOSE\n"));
 }
@@ -422,13 +869,13 @@ sys_chdir(uint8_t* args_start)
   char *dir;
   copy_in (&dir, args_start, sizeof(char*));
 
-  check_ptr(dir);
-  check_str(dir);
+  dir = copy_in_str(dir);
 
   bool ret;
   lock_acquire (&file_lock);
   ret = filesys_chdir(dir);
   lock_release (&file_lock);
+  palloc_free_page(dir);
 
   return ret;
 }
@@ -439,13 +886,13 @@ sys_mkdir(uint8_t* args_start)
   char *dir;
   copy_in (&dir, args_start, sizeof(char*));
 
-  check_ptr(dir);
-  check_str(dir);
+  dir = copy_in_str(dir);
 
   bool ret;
   lock_acquire (&file_lock);
   ret = filesys_create(dir, 0, DIR);
   lock_release (&file_lock);
+  palloc_free_page(dir);
 
   return ret;
 
@@ -459,6 +906,7 @@ sys_readdir(uint8_t* args_start)
   copy_in (&fd, args_start, sizeof(int));
   copy_in (&name, args_start+sizeof(int), sizeof(char*));
 
+  char kname[NAME_MAX + 1];
   bool ret = false;
 
   lock_acquire (&file_lock);
@@ -471,10 +919,12 @@ sys_readdir(uint8_t* args_start)
   if (inode_get_type (inode) != DIR) goto done;
 
   ASSERT (file_wrapper->dirptr != NULL);
-  ret = dir_readdir (file_wrapper->dirptr, name);
+  ret = dir_readdir (file_wrapper->dirptr, kname);
 
 done:
   lock_release (&file_lock);
+  if (ret && !copy_to_user (name, kname, strlen (kname) + 1))
+    kill_process();
   return ret;
 }
 
@@ -530,53 +980,341 @@ sys_inumber(uint8_t* args_start)
   
 }
 
+/* Copies up to LENGTH bytes from FD_IN to FD_OUT entirely inside
+   the kernel, starting at (and advancing) each file's current
+   position.  Returns the number of bytes copied, 0 at end of file,
+   or -1 if either fd is invalid or refers to a directory, the two
+   ranges overlap in the same file, or the kernel is out of
+   memory. */
+static int
+sys_copy_file_range(uint8_t* args_start)
+{
+  int fd_in, fd_out;
+  unsigned length;
+  copy_in (&fd_in, args_start, sizeof(int));
+  copy_in (&fd_out, args_start + sizeof(int), sizeof(int));
+  copy_in (&length, args_start + 2 * sizeof(int), sizeof(int));
+
+  if (length > INT32_MAX)
+    length = INT32_MAX;
+
+  lock_acquire (&file_lock);
+  struct file_in_thread* in = get_file(fd_in);
+  struct file_in_thread* out = get_file(fd_out);
+  if (in == NULL || out == NULL || in->dirptr != NULL || out->dirptr != NULL) {
+    lock_release (&file_lock);
+    return -1;
+  }
+  int ret = file_copy (out->fileptr, in->fileptr, length);
+  lock_release (&file_lock);
+
+  return ret;
+}
+
+/* Reads SIZE bytes from FD at byte OFFSET into BUFFER.  The fd's
+   current position is neither used nor changed, so concurrent
+   readers of one file need no seek in between. */
+static int
+sys_pread(uint8_t* args_start)
+{
+  int fd;
+  void* buffer;
+  unsigned size, offset;
+  copy_in (&fd, args_start, sizeof(int));
+  copy_in (&buffer, args_start + sizeof(int), sizeof(int));
+  copy_in (&size, args_start + 2 * sizeof(int), sizeof(int));
+  copy_in (&offset, args_start + 3 * sizeof(int), sizeof(int));
 
-/* Copies a byte from user address USRC to kernel address DST.  USRC must
-   be below PHYS_BASE.  Returns true if successful, false if a segfault
-   occurred. Unlike the one posted on the p2 website, this one takes two
-   arguments: dst, and usrc */
+  if (offset > INT32_MAX || size > INT32_MAX)
+    return -1;
+  return fd_io(fd, buffer, size, offset, false);
+}
 
-static inline bool
-get_user (uint8_t *dst, const uint8_t *usrc)
+/* Writes SIZE bytes from BUFFER to FD at byte OFFSET, leaving the
+   fd's current position unchanged. */
+static int
+sys_pwrite(uint8_t* args_start)
 {
-  int eax;
-  asm ("movl $1f, %%eax; movb %2, %%al; movb %%al, %0; 1:"
-       : "=m" (*dst), "=&a" (eax) : "m" (*usrc));
-  return eax != 0;
+  int fd;
+  void* buffer;
+  unsigned size, offset;
+  copy_in (&fd, args_start, sizeof(int));
+  copy_in (&buffer, args_start + sizeof(int), sizeof(int));
+  copy_in (&size, args_start + 2 * sizeof(int), sizeof(int));
+  copy_in (&offset, args_start + 3 * sizeof(int), sizeof(int));
 
+  if (offset > INT32_MAX || size > INT32_MAX)
+    return -1;
+  return fd_io(fd, buffer, size, offset, true);
 }
 
+static int
+sys_readv(uint8_t* args_start)
+{
+  return vectored_io (args_start, false);
+}
 
-/* Writes BYTE to user address UDST.  UDST must be below PHYS_BASE.
-   Returns true if successful, false if a segfault occurred. */
+static int
+sys_writev(uint8_t* args_start)
+{
+  return vectored_io (args_start, true);
+}
 
-static inline bool
-put_user (uint8_t *udst, uint8_t byte)
+/* Shared body of readv and writev.  Copies in the user's iovec
+   array, then transfers the buffers in order at the fd's current
+   position under a single hold of file_lock, or through a pipe
+   without it.  Stops early on a short transfer.  Returns the total
+   number of bytes transferred, or -1 on a bad fd or iovec count. */
+static int
+vectored_io (uint8_t* args_start, bool write)
 {
-  int eax;
-  asm ("movl $1f, %%eax; movb %b2, %0; 1:"
-       : "=m" (*udst), "=&a" (eax) : "q" (byte));
-  return eax != 0;
+  int fd, iovcnt;
+  const struct iovec* uiov;
+  copy_in (&fd, args_start, sizeof(int));
+  copy_in (&uiov, args_start + sizeof(int), sizeof(int));
+  copy_in (&iovcnt, args_start + 2 * sizeof(int), sizeof(int));
+
+  if (iovcnt < 0 || iovcnt > IOV_MAX)
+    return -1;
+  if (iovcnt == 0)
+    return 0;
+
+  struct iovec* iov = malloc(iovcnt * sizeof *iov);
+  if (iov == NULL)
+    return -1;
+  if (!copy_from_user (iov, uiov, iovcnt * sizeof *iov)) {
+    free(iov);
+    kill_process();
+  }
+
+  size_t total = 0;
+  int i;
+  for (i = 0; i < iovcnt; i++) {
+    total += iov[i].iov_len;
+    if (iov[i].iov_len > INT32_MAX || total > INT32_MAX) {
+      free(iov);
+      return -1;
+    }
+  }
+
+  struct file_in_thread* file = NULL;
+  struct pipe* pipe = NULL;
+  bool faulted = false;
+  int retval = 0;
+  lock_acquire (&file_lock);
+  bool console = fd_is_console(thread_current(), fd, write);
+  if (console)
+    lock_release (&file_lock);
+  else {
+    file = fd_lookup(thread_current(), fd);
+    if (file != NULL && file->pipe != NULL && file->writer == write) {
+      /* A pipe may block, so it must not hold up file_lock.  Our
+         own reference keeps it alive if the fd is closed meanwhile,
+         say by a queued ring request. */
+      pipe = file->pipe;
+      pipe_dup(pipe, write);
+      lock_release (&file_lock);
+    }
+    else if (file == NULL || file->pipe != NULL || file->dirptr != NULL) {
+      lock_release (&file_lock);
+      free(iov);
+      return -1;
+    }
+  }
+  for (i = 0; i < iovcnt && !faulted; i++) {
+    off_t len = iov[i].iov_len;
+    off_t done;
+    if (pipe != NULL)
+      done = xfer_pipe (pipe, iov[i].iov_base, len, write, &faulted);
+    else
+      done = xfer_user (console ? NULL : file->fileptr, iov[i].iov_base,
+                        len, -1, write, &faulted);
+    if (done < 0) {
+      if (retval == 0)
+        retval = -1;
+      break;
+    }
+    retval += done;
+    if (done < len)
+      break;
+  }
+  if (pipe != NULL)
+    pipe_close(pipe, write);
+  else if (!console)
+    lock_release (&file_lock);
+  free(iov);
+  if (faulted)
+    kill_process();
+  return retval;
 }
 
+/* Moves SIZE bytes between FD and user buffer UBUF: reads from FD
+   into UBUF if WRITE is false, writes UBUF to FD otherwise.  Reads
+   from fd 0 and writes to fd 1 go to the console unless a file has
+   been installed there; anything else must be an open file or the
+   matching end of a pipe.  OFS is as for xfer_user(), but must be
+   negative for the console or a pipe.  Kills the process if UBUF is bad.  Returns
+   the number of bytes moved, or -1 if FD is not usable. */
+static int
+fd_io (int fd, void *ubuf, off_t size, off_t ofs, bool write)
+{
+  bool faulted = false;
+  int ret;
 
+  lock_acquire (&file_lock);
+  if (fd_is_console(thread_current(), fd, write)) {
+    /* The console may block, and has no position to move. */
+    lock_release (&file_lock);
+    if (ofs >= 0)
+      ret = -1;
+    else
+      ret = xfer_user (NULL, ubuf, size, ofs, write, &faulted);
+  }
+  else {
+    struct file_in_thread* file = fd_lookup(thread_current(), fd);
+    if (file != NULL && file->pipe != NULL) {
+      /* A pipe may block, so it must not hold up file_lock.  Our
+         own reference keeps it alive if the fd is closed meanwhile,
+         say by a queued ring request. */
+      struct pipe *pipe = file->pipe;
+      bool usable = ofs < 0 && write == file->writer;
+      if (usable)
+        pipe_dup(pipe, write);
+      lock_release (&file_lock);
+      if (!usable)
+        ret = -1;
+      else {
+        ret = xfer_pipe (pipe, ubuf, size, write, &faulted);
+        pipe_close(pipe, write);
+      }
+    }
+    else {
+      if (file == NULL || file->dirptr != NULL)
+        ret = -1;
+      else
+        ret = xfer_user (file->fileptr, ubuf, size, ofs, write, &faulted);
+      lock_release (&file_lock);
+    }
+  }
+  if (faulted)
+    kill_process();
+  return ret;
+}
 
-/* Copies SIZE bytes from user address USRC to kernel address DST.  Call
-   thread_exit() if any of the user accesses are invalid. */ 
+/* Transfers SIZE bytes between PIPE and user buffer UBUF: reads
+   from PIPE if WRITE is false, writes to it otherwise.  A read
+   waits for data and then returns what is there.  Otherwise as for
+   xfer_user().  The caller must not hold file_lock. */
+static int
+xfer_pipe (struct pipe *pipe, uint8_t *ubuf, off_t size, bool write,
+           bool *faulted)
+{
+  if (write)
+    return pipe_write (pipe, ubuf, size, faulted);
+  else
+    return pipe_read (pipe, ubuf, size, faulted);
+}
 
-static void copy_in (void *dst_, const void *usrc_, size_t size) { 
-  //printf("copying %d bytes to %p kernel from %p user\n", size, dst_, usrc_);
-  uint8_t *dst = dst_; 
-  const uint8_t *usrc = usrc_;
-  //printf("user ptr out of bounds? %d\n", usrc_ >= ( (uint8_t *) PHYS_BASE));
-  struct thread* t = thread_current();
-  for (; size > 0; size--, dst++, usrc++)
-    {
-      check_ptr(usrc_);
-      if (!get_user (dst, usrc)) {
-        t->exitstatus = -1;
-        thread_exit ();
+/* Bytes moved at a time when no bounce page can be had. */
+#define XFER_FALLBACK 128
+
+/* Transfers SIZE bytes between FILE and user buffer UBUF a page at
+   a time through a kernel bounce page, so the user buffer is never
+   validated up front: a bad address simply makes copy_from_user()
+   or copy_to_user() fail.  If the kernel pool is out of pages, a
+   small buffer on the stack does instead, more slowly.  A null FILE means the console.  If OFS
+   is negative the transfer uses and advances the file's current
+   position; otherwise it starts at byte OFS and leaves the
+   position alone.  Returns the number of bytes transferred, which
+   is short at end of file, or for a console read, once the keys
+   typed so far have been consumed.  On a bad user address, sets *FAULTED
+   and stops; the caller must drop file_lock and kill the
+   process. */
+static int
+xfer_user (struct file *file, uint8_t *ubuf, off_t size, off_t ofs,
+           bool write, bool *faulted)
+{
+  uint8_t fallback[XFER_FALLBACK];
+  uint8_t *bounce;
+  off_t bounce_size = PGSIZE;
+  int done = 0;
+
+  if (size == 0)
+    return 0;
+  bounce = palloc_get_page (0);
+  if (bounce == NULL) {
+    bounce = fallback;
+    bounce_size = sizeof fallback;
+  }
+
+  while (size > 0) {
+    off_t chunk = size < bounce_size ? size : bounce_size;
+    off_t moved;
+
+    if (write) {
+      if (!copy_from_user (bounce, ubuf + done, chunk)) {
+        *faulted = true;
+        break;
+      }
+      if (file == NULL) {
+        putbuf ((const char *) bounce, chunk);
+        moved = chunk;
+      }
+      else if (ofs < 0)
+        moved = file_write (file, bounce, chunk);
+      else
+        moved = file_write_at (file, bounce, chunk, ofs + done);
+    }
+    else {
+      if (file == NULL)
+        moved = input_getbuf (bounce, chunk);
+      else if (ofs < 0)
+        moved = file_read (file, bounce, chunk);
+      else
+        moved = file_read_at (file, bounce, chunk, ofs + done);
+      if (moved > 0 && !copy_to_user (ubuf + done, bounce, moved)) {
+        *faulted = true;
+        break;
+      }
     }
 
+    if (moved < 0) {
+      if (done == 0)
+        done = -1;
+      break;
     }
+    done += moved;
+    size -= moved;
+    if (moved < chunk)
+      break;
+  }
+  if (bounce != fallback)
+    palloc_free_page (bounce);
+  return done;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address DST.
+   Kills the process if any of the user accesses are invalid. */
+static void copy_in (void *dst, const void *usrc, size_t size) { 
+  if (!copy_from_user (dst, usrc, size))
+    kill_process();
+}
+
+/* Registers the process's submission/completion ring. */
+static int
+sys_uring_setup (uint8_t* args_start)
+{
+  struct uring* ring;
+  copy_in (&ring, args_start, sizeof(struct uring*));
+  return uring_setup (ring) ? 0 : -1;
+}
+
+/* Submits queued ring entries and waits for completions. */
+static int
+sys_uring_enter (uint8_t* args_start)
+{
+  unsigned to_submit, min_complete;
+  copy_in (&to_submit, args_start, sizeof(int));
+  copy_in (&min_complete, args_start + sizeof(int), sizeof(int));
+  return uring_enter (to_submit, min_complete);
 }
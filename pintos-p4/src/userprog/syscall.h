@@ -1,6 +1,34 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stdbool.h>
+#include <spawn.h>
+
+struct thread;
+struct file;
+struct dir;
+struct pipe;
+
+/* An open file descriptor. */
+struct file_in_thread {
+  struct file *fileptr;
+  struct dir *dirptr;           /* Non-null if the file is a directory. */
+  struct pipe *pipe;            /* Non-null if this is a pipe end, in
+                                   which case FILEPTR is null. */
+  bool writer;                  /* Write end of PIPE? */
+  int fd;
+};
+
 void syscall_init (void);
+void syscall_exit (void);
+
+struct file_in_thread *fd_lookup (struct thread *, int fd);
+int fd_install (struct thread *, struct file *);
+int fd_install_at (struct thread *, struct file *, int fd);
+bool fd_close (struct thread *, int fd);
+bool fd_is_console (struct thread *, int fd, bool write);
+
+bool syscall_spawn_fds (struct thread *parent, const struct spawn_action *,
+                        int cnt);
 
 #endif /* userprog/syscall.h */
@@ -0,0 +1,175 @@
+#include "userprog/uaccess.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Safe access to user memory.
+
+   The routines below touch user memory directly, without first
+   checking that it is mapped.  Each instruction that may fault
+   on a bad user address is listed in the __ex_table section
+   along with a fixup address.  When such an instruction faults,
+   page_fault() finds it with uaccess_fixup() and resumes at the
+   fixup instead of panicking, and the fixup makes the routine
+   return false.  Bulk copies thus run at memcpy speed with no
+   page table walks, and a bad address costs one page fault. */
+
+/* One exception table entry.  The linker script collects all of
+   them between _start_ex_table and _end_ex_table. */
+struct ex_entry
+  {
+    uintptr_t insn;             /* Instruction that may fault. */
+    uintptr_t fixup;            /* Where to resume if it does. */
+  };
+
+extern const struct ex_entry _start_ex_table[], _end_ex_table[];
+
+/* Emits an exception table entry sending faults at label INSN to
+   label FIXUP. */
+#define EX_ENTRY(INSN, FIXUP)                           \
+        ".section __ex_table, \"a\"\n"                  \
+        "\t.balign 4\n"                                 \
+        "\t.long " INSN ", " FIXUP "\n"                 \
+        ".previous\n"
+
+/* Returns true if the SIZE bytes starting at UADDR lie entirely
+   below PHYS_BASE, false if any of them is a kernel address. */
+static inline bool
+is_user_range (const void *uaddr, size_t size)
+{
+  uintptr_t start = (uintptr_t) uaddr;
+  return start + size >= start && start + size <= (uintptr_t) PHYS_BASE;
+}
+
+/* Copies a byte from user address USRC to kernel address DST.
+   Returns true if successful, false if USRC is not a valid user
+   address. */
+bool
+get_user (uint8_t *dst, const uint8_t *usrc)
+{
+  int error;
+  uint8_t byte;
+
+  if (!is_user_vaddr (usrc))
+    return false;
+  asm volatile ("xorl %0, %0\n"
+                "1:\tmovb %2, %1\n"
+                "\tjmp 3f\n"
+                "2:\tmovl $1, %0\n"
+                "3:\n"
+                EX_ENTRY ("1b", "2b")
+                : "=&r" (error), "=q" (byte) : "m" (*usrc));
+  if (error)
+    return false;
+  *dst = byte;
+  return true;
+}
+
+/* Writes BYTE to user address UDST.  Returns true if successful,
+   false if UDST is not a valid, writable user address. */
+bool
+put_user (uint8_t *udst, uint8_t byte)
+{
+  int error;
+
+  if (!is_user_vaddr (udst))
+    return false;
+  asm volatile ("xorl %0, %0\n"
+                "1:\tmovb %b2, %1\n"
+                "\tjmp 3f\n"
+                "2:\tmovl $1, %0\n"
+                "3:\n"
+                EX_ENTRY ("1b", "2b")
+                : "=&r" (error), "=m" (*udst) : "q" (byte));
+  return error == 0;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address DST.
+   Returns true if successful, false if any byte of the source is
+   not a valid user address, in which case DST holds whatever was
+   copied before the fault. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size)
+{
+  int error;
+
+  if (!is_user_range (usrc, size))
+    return false;
+  asm volatile ("xorl %0, %0\n"
+                "1:\trep movsb\n"
+                "\tjmp 3f\n"
+                "2:\tmovl $1, %0\n"
+                "3:\n"
+                EX_ENTRY ("1b", "2b")
+                : "=&r" (error), "+D" (dst), "+S" (usrc), "+c" (size)
+                : : "memory");
+  return error == 0;
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address UDST.
+   Returns true if successful, false if any byte of the
+   destination is not a valid, writable user address. */
+bool
+copy_to_user (void *udst, const void *src, size_t size)
+{
+  int error;
+
+  if (!is_user_range (udst, size))
+    return false;
+  asm volatile ("xorl %0, %0\n"
+                "1:\trep movsb\n"
+                "\tjmp 3f\n"
+                "2:\tmovl $1, %0\n"
+                "3:\n"
+                EX_ENTRY ("1b", "2b")
+                : "=&r" (error), "+D" (udst), "+S" (src), "+c" (size)
+                : : "memory");
+  return error == 0;
+}
+
+/* Creates a copy of user string US in kernel memory and returns it
+   as a page that must be freed with palloc_free_page().  Truncates
+   the string at PGSIZE bytes in size.  Returns a null pointer if
+   any of the user accesses are invalid or no page is available. */
+char *
+copy_in_string (const char *us)
+{
+  char *ks;
+  size_t length;
+
+  ks = palloc_get_page (0);
+  if (ks == NULL)
+    return NULL;
+
+  for (length = 0; length < PGSIZE; length++)
+    {
+      if (!get_user ((uint8_t *) ks + length, (const uint8_t *) us + length))
+        {
+          palloc_free_page (ks);
+          return NULL;
+        }
+      if (ks[length] == '\0')
+        return ks;
+    }
+  ks[PGSIZE - 1] = '\0';
+  return ks;
+}
+
+/* Called by the page fault handler for a fault in kernel mode.
+   If the faulting instruction is one of the user accesses above,
+   redirects F to its fixup and returns true.  Otherwise returns
+   false, meaning the fault is a genuine kernel bug. */
+bool
+uaccess_fixup (struct intr_frame *f)
+{
+  const struct ex_entry *e;
+
+  for (e = _start_ex_table; e < _end_ex_table; e++)
+    if (e->insn == (uintptr_t) f->eip)
+      {
+        f->eip = (void (*) (void)) e->fixup;
+        return true;
+      }
+  return false;
+}
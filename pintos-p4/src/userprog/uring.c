@@ -0,0 +1,459 @@
+#include "userprog/uring.h"
+#include <debug.h>
+#include <list.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/syscall.h"
+#include "userprog/uaccess.h"
+
+/* Batched asynchronous system calls.
+
+   The ring itself lives in the process's memory.  uring_enter()
+   copies queued submissions into kernel requests, along with any
+   data to be written or file name to be opened, and queues them
+   on the process's uring_ctx.  A small pool of worker threads
+   runs the requests: a ring with pending requests sits on
+   ready_rings until a worker takes it, and a worker runs one
+   request at a time from a given ring, so each ring's requests
+   execute in submission order while different processes'
+   requests overlap with each other and with the submitters.
+
+   Workers have no user address space, so they never touch user
+   memory.  Nor do they wait for the keyboard: with so few of them,
+   a console read could stall every ring, and the owner's exit,
+   until someone types, so it fails instead.  Finished requests wait on the ring's done list until
+   the owner next calls uring_enter(), which copies read data out
+   and posts the completions to the ring. */
+
+/* Number of kernel threads that execute ring requests. */
+#define URING_WORKERS 2
+
+/* A process's registered ring. */
+struct uring_ctx
+  {
+    struct thread *owner;       /* Process that registered the ring. */
+    struct uring *uring;        /* Ring in the owner's user memory. */
+    unsigned sq_head;           /* Kernel copy of uring->sq_head. */
+    unsigned cq_tail;           /* Kernel copy of uring->cq_tail. */
+    unsigned inflight;          /* Submitted but not yet posted. */
+    struct list pending;        /* Requests waiting for a worker. */
+    struct list done;           /* Finished requests not yet posted. */
+    bool busy;                  /* Is a worker running a request? */
+    struct list_elem elem;      /* Element in ready_rings. */
+    struct condition completed; /* Signaled when a request finishes. */
+  };
+
+/* One submitted request. */
+struct uring_req
+  {
+    struct uring_sqe sqe;       /* Copy of the submission entry. */
+    void *kbuf;                 /* Kernel copy of data or file name. */
+    block_sector_t wd;          /* Submitter's working directory. */
+    int res;                    /* Result, once done. */
+    struct list_elem elem;      /* Element in pending or done. */
+  };
+
+/* Protects ready_rings and every ring's pending and done lists
+   and busy flag. */
+static struct lock uring_lock;
+
+/* Rings that have pending requests and no worker running one.
+   A ring is on this list exactly when its pending list is
+   nonempty and it is not busy. */
+static struct list ready_rings;
+
+/* Signaled when a ring is added to ready_rings. */
+static struct condition work_ready;
+
+static void uring_worker (void *);
+static int uring_execute (struct thread *owner, struct uring_req *);
+static struct uring_req *uring_prepare (const struct uring_sqe *);
+static void uring_reap (struct uring_ctx *, unsigned min_complete);
+static void uring_post (struct uring_ctx *, struct uring_req *);
+static void uring_free_req (struct uring_req *);
+static void uring_get (void *dst, const void *usrc, size_t size);
+static void uring_put (void *udst, const void *src, size_t size);
+static void uring_kill (void) NO_RETURN;
+
+/* Initializes the ring subsystem and starts its worker threads. */
+void
+uring_init (void)
+{
+  int i;
+
+  lock_init (&uring_lock);
+  list_init (&ready_rings);
+  cond_init (&work_ready);
+  for (i = 0; i < URING_WORKERS; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "uring-%d", i);
+      thread_create (name, PRI_DEFAULT, uring_worker, NULL);
+    }
+}
+
+/* Registers RING as the current process's ring and resets its
+   indexes to zero.  Returns false if the process already has a
+   ring or memory is exhausted.  Kills the process if RING is not
+   valid user memory. */
+bool
+uring_setup (struct uring *ring)
+{
+  struct thread *cur = thread_current ();
+  struct uring_ctx *ctx;
+  static const unsigned zero[4];
+
+  if (cur->uring != NULL)
+    return false;
+  uring_put (ring, zero, sizeof zero);
+
+  ctx = malloc (sizeof *ctx);
+  if (ctx == NULL)
+    return false;
+  ctx->owner = cur;
+  ctx->uring = ring;
+  ctx->sq_head = 0;
+  ctx->cq_tail = 0;
+  ctx->inflight = 0;
+  list_init (&ctx->pending);
+  list_init (&ctx->done);
+  ctx->busy = false;
+  cond_init (&ctx->completed);
+  cur->uring = ctx;
+  return true;
+}
+
+/* Hands up to TO_SUBMIT queued submissions from the current
+   process's ring to the workers, then posts finished requests to
+   the completion queue, waiting until at least MIN_COMPLETE
+   completions are available (or nothing is left in flight).
+   Returns the number of requests submitted, or -1 if the process
+   has no ring.  Submission stops early when URING_ENTRIES
+   requests are already in flight. */
+int
+uring_enter (unsigned to_submit, unsigned min_complete)
+{
+  struct uring_ctx *ctx = thread_current ()->uring;
+  unsigned sq_tail;
+  int submitted = 0;
+
+  if (ctx == NULL)
+    return -1;
+
+  uring_get (&sq_tail, &ctx->uring->sq_tail, sizeof sq_tail);
+  while ((unsigned) submitted < to_submit && ctx->sq_head != sq_tail
+         && ctx->inflight < URING_ENTRIES)
+    {
+      struct uring_sqe sqe;
+      struct uring_req *req;
+
+      uring_get (&sqe, &ctx->uring->sqes[ctx->sq_head % URING_ENTRIES],
+                 sizeof sqe);
+      req = uring_prepare (&sqe);
+      if (req == NULL)
+        break;
+      ctx->sq_head++;
+      ctx->inflight++;
+      submitted++;
+
+      lock_acquire (&uring_lock);
+      if (sqe.opcode > URING_OP_NOP && sqe.opcode <= URING_OP_CLOSE)
+        {
+          if (!ctx->busy && list_empty (&ctx->pending))
+            {
+              list_push_back (&ready_rings, &ctx->elem);
+              cond_signal (&work_ready, &uring_lock);
+            }
+          list_push_back (&ctx->pending, &req->elem);
+        }
+      else
+        {
+          /* No-ops and unknown requests complete at once. */
+          req->res = sqe.opcode == URING_OP_NOP ? 0 : -1;
+          list_push_back (&ctx->done, &req->elem);
+        }
+      lock_release (&uring_lock);
+    }
+  uring_put (&ctx->uring->sq_head, &ctx->sq_head, sizeof ctx->sq_head);
+
+  uring_reap (ctx, min_complete);
+  return submitted;
+}
+
+/* Tears down the current process's ring, if any.  Requests that
+   have not started are dropped; one that a worker is running is
+   allowed to finish first, since it may be using the process's
+   fd table.  Called before the process's files are closed. */
+void
+uring_exit (void)
+{
+  struct thread *cur = thread_current ();
+  struct uring_ctx *ctx = cur->uring;
+
+  if (ctx == NULL)
+    return;
+
+  lock_acquire (&uring_lock);
+  if (!ctx->busy && !list_empty (&ctx->pending))
+    list_remove (&ctx->elem);
+  while (!list_empty (&ctx->pending))
+    uring_free_req (list_entry (list_pop_front (&ctx->pending),
+                                struct uring_req, elem));
+  while (ctx->busy)
+    cond_wait (&ctx->completed, &uring_lock);
+  while (!list_empty (&ctx->done))
+    uring_free_req (list_entry (list_pop_front (&ctx->done),
+                                struct uring_req, elem));
+  lock_release (&uring_lock);
+
+  cur->uring = NULL;
+  free (ctx);
+}
+
+/* Worker thread: repeatedly takes the ring at the head of
+   ready_rings and runs its oldest pending request. */
+static void
+uring_worker (void *aux UNUSED)
+{
+  lock_acquire (&uring_lock);
+  for (;;)
+    {
+      struct uring_ctx *ctx;
+      struct uring_req *req;
+
+      while (list_empty (&ready_rings))
+        cond_wait (&work_ready, &uring_lock);
+      ctx = list_entry (list_pop_front (&ready_rings), struct uring_ctx, elem);
+      req = list_entry (list_pop_front (&ctx->pending), struct uring_req, elem);
+      ctx->busy = true;
+      lock_release (&uring_lock);
+
+      req->res = uring_execute (ctx->owner, req);
+
+      lock_acquire (&uring_lock);
+      list_push_back (&ctx->done, &req->elem);
+      ctx->busy = false;
+      if (!list_empty (&ctx->pending))
+        list_push_back (&ready_rings, &ctx->elem);
+      cond_broadcast (&ctx->completed, &uring_lock);
+    }
+}
+
+/* Runs REQ on behalf of process OWNER and returns its result.
+   Descriptors are looked up in OWNER's fd table when the request
+   runs, just as the synchronous system call would. */
+static int
+uring_execute (struct thread *owner, struct uring_req *req)
+{
+  struct uring_sqe *sqe = &req->sqe;
+  struct file_in_thread *file;
+  bool console = false;
+  int res = -1;
+
+  /* Console transfers run without file_lock. */
+  if (sqe->opcode == URING_OP_READ || sqe->opcode == URING_OP_WRITE)
+    {
+      lock_acquire (&file_lock);
+      console = fd_is_console (owner, sqe->fd,
+                               sqe->opcode == URING_OP_WRITE);
+      lock_release (&file_lock);
+    }
+  if (console && sqe->opcode == URING_OP_READ)
+    return -1;
+  if (console)
+    {
+      putbuf (req->kbuf, sqe->len);
+      return sqe->len;
+    }
+
+  lock_acquire (&file_lock);
+  switch (sqe->opcode)
+    {
+    case URING_OP_READ:
+    case URING_OP_WRITE:
+      file = fd_lookup (owner, sqe->fd);
+      if (file != NULL && file->dirptr == NULL && file->pipe == NULL)
+        res = (sqe->opcode == URING_OP_READ
+               ? file_read (file->fileptr, req->kbuf, sqe->len)
+               : file_write (file->fileptr, req->kbuf, sqe->len));
+      break;
+
+    case URING_OP_OPEN:
+      {
+        struct file *f;
+
+        /* Resolve relative names against the submitter's
+           directory at submission time. */
+        thread_current ()->wd = req->wd;
+        f = file_open (filesys_open (req->kbuf));
+        if (f != NULL)
+          res = fd_install (owner, f);
+      }
+      break;
+
+    case URING_OP_CLOSE:
+      res = fd_close (owner, sqe->fd) ? 0 : -1;
+      break;
+
+    default:
+      NOT_REACHED ();
+    }
+  lock_release (&file_lock);
+  return res;
+}
+
+/* Creates a request for SQE, copying in the data to write or the
+   file name to open.  Returns a null pointer if memory is
+   exhausted.  Kills the process if SQE refers to bad user
+   memory. */
+static struct uring_req *
+uring_prepare (const struct uring_sqe *sqe)
+{
+  struct uring_req *req = malloc (sizeof *req);
+  if (req == NULL)
+    return NULL;
+  req->sqe = *sqe;
+  req->kbuf = NULL;
+  req->wd = thread_current ()->wd;
+  req->res = -1;
+
+  switch (sqe->opcode)
+    {
+    case URING_OP_READ:
+    case URING_OP_WRITE:
+      if (req->sqe.len > URING_MAX_LEN)
+        req->sqe.len = URING_MAX_LEN;
+      if (req->sqe.len == 0)
+        break;
+      req->kbuf = malloc (req->sqe.len);
+      if (req->kbuf == NULL)
+        {
+          free (req);
+          return NULL;
+        }
+      if (sqe->opcode == URING_OP_WRITE
+          && !copy_from_user (req->kbuf, sqe->buf, req->sqe.len))
+        {
+          uring_free_req (req);
+          uring_kill ();
+        }
+      break;
+
+    case URING_OP_OPEN:
+      req->kbuf = copy_in_string (sqe->buf);
+      if (req->kbuf == NULL)
+        {
+          free (req);
+          uring_kill ();
+        }
+      break;
+    }
+  return req;
+}
+
+/* Posts finished requests from CTX to its completion queue until
+   at least MIN_COMPLETE completions are available to the process,
+   the queue is full, or nothing is left in flight.  Blocks while
+   requests are still running. */
+static void
+uring_reap (struct uring_ctx *ctx, unsigned min_complete)
+{
+  if (min_complete > URING_ENTRIES)
+    min_complete = URING_ENTRIES;
+
+  for (;;)
+    {
+      struct uring_req *req;
+      unsigned cq_head;
+
+      uring_get (&cq_head, &ctx->uring->cq_head, sizeof cq_head);
+      if (ctx->cq_tail - cq_head >= URING_ENTRIES)
+        return;
+
+      lock_acquire (&uring_lock);
+      if (list_empty (&ctx->done))
+        {
+          if (ctx->cq_tail - cq_head < min_complete && ctx->inflight > 0)
+            cond_wait (&ctx->completed, &uring_lock);
+          else
+            {
+              lock_release (&uring_lock);
+              return;
+            }
+          lock_release (&uring_lock);
+          continue;
+        }
+      req = list_entry (list_pop_front (&ctx->done), struct uring_req, elem);
+      lock_release (&uring_lock);
+
+      uring_post (ctx, req);
+    }
+}
+
+/* Copies REQ's read data out to the process, writes its
+   completion entry at the tail of CTX's completion queue, and
+   frees it. */
+static void
+uring_post (struct uring_ctx *ctx, struct uring_req *req)
+{
+  struct uring_cqe cqe;
+
+  if (req->sqe.opcode == URING_OP_READ && req->res > 0
+      && !copy_to_user (req->sqe.buf, req->kbuf, req->res))
+    {
+      uring_free_req (req);
+      uring_kill ();
+    }
+
+  cqe.user_data = req->sqe.user_data;
+  cqe.res = req->res;
+  uring_put (&ctx->uring->cqes[ctx->cq_tail % URING_ENTRIES],
+             &cqe, sizeof cqe);
+  ctx->cq_tail++;
+  uring_put (&ctx->uring->cq_tail, &ctx->cq_tail, sizeof ctx->cq_tail);
+  ctx->inflight--;
+  uring_free_req (req);
+}
+
+/* Frees REQ and its kernel buffer. */
+static void
+uring_free_req (struct uring_req *req)
+{
+  if (req->sqe.opcode == URING_OP_OPEN)
+    palloc_free_page (req->kbuf);
+  else
+    free (req->kbuf);
+  free (req);
+}
+
+/* Copies SIZE bytes from the ring at USRC, killing the process if
+   the ring is no longer valid user memory. */
+static void
+uring_get (void *dst, const void *usrc, size_t size)
+{
+  if (!copy_from_user (dst, usrc, size))
+    uring_kill ();
+}
+
+/* Copies SIZE bytes into the ring at UDST, killing the process if
+   the ring is no longer valid user memory. */
+static void
+uring_put (void *udst, const void *src, size_t size)
+{
+  if (!copy_to_user (udst, src, size))
+    uring_kill ();
+}
+
+/* Terminates the current process with exit status -1. */
+static void
+uring_kill (void)
+{
+  thread_current ()->exitstatus = -1;
+  thread_exit ();
+}
@@ -0,0 +1,12 @@
+#ifndef USERPROG_URING_H
+#define USERPROG_URING_H
+
+#include <stdbool.h>
+#include <uring.h>
+
+void uring_init (void);
+bool uring_setup (struct uring *);
+int uring_enter (unsigned to_submit, unsigned min_complete);
+void uring_exit (void);
+
+#endif /* userprog/uring.h */
@@ -0,0 +1,251 @@
+#include "vm/mmap.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+
+/* Memory-mapped files.
+
+   A mapping covers the pages of a file laid out from a
+   page-aligned user address, the last page zero-filled past the
+   end of the file.  Nothing is read at mmap() time: a page is read
+   in from the file the first time it is touched, by the process or
+   by the kernel copying to or from it on the process's behalf, and
+   the next few pages of the mapping are read along with it, on the
+   guess that access is sequential.
+
+   A page that has been written, as the page directory's dirty bit
+   shows, is written back to the file when it is unmapped, by
+   munmap() or at exit; a clean one is simply dropped.  Only the
+   bytes that were in the file at mmap() time are written back, so
+   a mapping never changes the file's length.
+
+   Pages are allocated from the user pool and stay resident until
+   unmapped: this kernel has no page replacement, so there is no
+   eviction to write them back earlier.
+
+   A page fault on a mapping can come from inside the kernel, while
+   it copies to or from user memory holding file_lock, a pipe's
+   lock, or both, and those are taken in the order file_lock, then
+   pipe lock.  So page-in must not take file_lock itself: reads
+   from mapped files are serialized by mmap_lock instead, which is
+   never held while touching user memory and so nests inside any
+   other lock.  A read does without file_lock because it changes
+   nothing on disk, and each sector it reads arrives whole. */
+
+/* Number of pages read after the faulting one. */
+#define MMAP_READAHEAD 4
+
+/* Serializes page-in reads from mapped files. */
+static struct lock mmap_lock;
+
+/* A memory-mapped file. */
+struct mapping
+  {
+    int mapid;                  /* Mapping identifier. */
+    struct file *file;          /* Our own handle on the file. */
+    uint8_t *base;              /* First user page mapped. */
+    size_t page_cnt;            /* Number of pages mapped. */
+    off_t length;               /* File length when mapped. */
+    struct list_elem elem;      /* Element in thread's mappings. */
+  };
+
+static struct mapping *find_mapping (const void *uaddr);
+static bool map_page (struct mapping *, size_t page_idx);
+static void unmap (struct mapping *);
+
+/* Initializes memory-mapped files. */
+void
+mmap_init (void)
+{
+  lock_init (&mmap_lock);
+}
+
+/* Maps FILE, which the caller has just opened and gives to the
+   mapping, into the current process starting at ADDR.  Returns the
+   new mapping's identifier, or -1 (closing FILE) if FILE is empty,
+   ADDR is null or not page-aligned, or the pages to be mapped are
+   not all unused user pages. */
+int
+mmap_map (struct file *file, void *addr)
+{
+  struct thread *cur = thread_current ();
+  struct mapping *m;
+  off_t length;
+  size_t i;
+
+  lock_acquire (&file_lock);
+  length = file_length (file);
+  lock_release (&file_lock);
+  if (length == 0 || addr == NULL || pg_ofs (addr) != 0)
+    goto fail;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    goto fail;
+  m->file = file;
+  m->base = addr;
+  m->page_cnt = DIV_ROUND_UP (length, PGSIZE);
+  m->length = length;
+  for (i = 0; i < m->page_cnt; i++)
+    {
+      uint8_t *upage = m->base + i * PGSIZE;
+      if (upage < m->base || !is_user_vaddr (upage)
+          || pagedir_get_page (cur->pagedir, upage) != NULL
+          || find_mapping (upage) != NULL)
+        {
+          free (m);
+          goto fail;
+        }
+    }
+
+  m->mapid = cur->next_mapid++;
+  list_push_back (&cur->mappings, &m->elem);
+  return m->mapid;
+
+ fail:
+  lock_acquire (&file_lock);
+  file_close (file);
+  lock_release (&file_lock);
+  return -1;
+}
+
+/* Unmaps mapping MAPID in the current process, writing back its
+   dirty pages.  Returns false if there is no such mapping. */
+bool
+mmap_unmap (int mapid)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&cur->mappings); e != list_end (&cur->mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if (m->mapid == mapid)
+        {
+          unmap (m);
+          return true;
+        }
+    }
+  return false;
+}
+
+/* Reads in the not-present page containing FAULT_ADDR, and up to
+   MMAP_READAHEAD more after it, if FAULT_ADDR lies in one of the
+   current process's mappings.  Returns true if the faulting access
+   may be retried, false if FAULT_ADDR is not mapped or memory is
+   exhausted. */
+bool
+mmap_fault (void *fault_addr)
+{
+  struct mapping *m = find_mapping (fault_addr);
+  size_t idx, i;
+  bool ok;
+
+  if (m == NULL)
+    return false;
+
+  lock_acquire (&mmap_lock);
+  idx = ((uint8_t *) pg_round_down (fault_addr) - m->base) / PGSIZE;
+  ok = map_page (m, idx);
+  for (i = idx + 1; ok && i <= idx + MMAP_READAHEAD && i < m->page_cnt; i++)
+    if (pagedir_get_page (thread_current ()->pagedir, m->base + i * PGSIZE)
+        == NULL && !map_page (m, i))
+      break;
+  lock_release (&mmap_lock);
+  return ok;
+}
+
+/* Unmaps all of the current process's mappings, writing back their
+   dirty pages.  Called at process exit, before the page directory
+   is destroyed. */
+void
+mmap_exit (void)
+{
+  struct thread *cur = thread_current ();
+
+  while (!list_empty (&cur->mappings))
+    unmap (list_entry (list_front (&cur->mappings), struct mapping, elem));
+}
+
+/* Returns the current process's mapping that contains UADDR, or a
+   null pointer if there is none. */
+static struct mapping *
+find_mapping (const void *uaddr)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&cur->mappings); e != list_end (&cur->mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if ((const uint8_t *) uaddr >= m->base
+          && (const uint8_t *) uaddr < m->base + m->page_cnt * PGSIZE)
+        return m;
+    }
+  return NULL;
+}
+
+/* Reads page PAGE_IDX of M from its file into a new page and maps
+   it writable, with clear accessed and dirty bits.  Returns false
+   if memory is exhausted.  The caller must hold mmap_lock. */
+static bool
+map_page (struct mapping *m, size_t page_idx)
+{
+  off_t ofs = page_idx * PGSIZE;
+  off_t bytes = m->length - ofs < PGSIZE ? m->length - ofs : PGSIZE;
+  uint8_t *kpage = palloc_get_page (PAL_USER);
+
+  if (kpage == NULL)
+    return false;
+  bytes = file_read_at (m->file, kpage, bytes, ofs);
+  memset (kpage + bytes, 0, PGSIZE - bytes);
+  if (!pagedir_set_page (thread_current ()->pagedir, m->base + ofs, kpage,
+                         true))
+    {
+      palloc_free_page (kpage);
+      return false;
+    }
+  return true;
+}
+
+/* Writes back M's dirty pages, frees its pages, closes its file,
+   and frees M. */
+static void
+unmap (struct mapping *m)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  size_t i;
+
+  lock_acquire (&file_lock);
+  for (i = 0; i < m->page_cnt; i++)
+    {
+      uint8_t *upage = m->base + i * PGSIZE;
+      uint8_t *kpage = pagedir_get_page (pd, upage);
+      off_t ofs = i * PGSIZE;
+
+      if (kpage == NULL)
+        continue;
+      if (pagedir_is_dirty (pd, upage))
+        file_write_at (m->file, kpage,
+                       m->length - ofs < PGSIZE ? m->length - ofs : PGSIZE,
+                       ofs);
+      pagedir_clear_page (pd, upage);
+      palloc_free_page (kpage);
+    }
+  file_close (m->file);
+  lock_release (&file_lock);
+
+  list_remove (&m->elem);
+  free (m);
+}
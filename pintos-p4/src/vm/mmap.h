@@ -0,0 +1,14 @@
+#ifndef VM_MMAP_H
+#define VM_MMAP_H
+
+#include <stdbool.h>
+
+struct file;
+
+void mmap_init (void);
+int mmap_map (struct file *, void *addr);
+bool mmap_unmap (int mapid);
+bool mmap_fault (void *fault_addr);
+void mmap_exit (void);
+
+#endif /* vm/mmap.h */